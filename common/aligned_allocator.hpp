@@ -0,0 +1,109 @@
+// Copyright 2013 Mario Mulansky
+// allocator for the data blocks: storage starts at a cache line boundary and
+// is padded to a whole number of cache lines, so the edges of two blocks
+// written by different threads never share a cache line, and simd loads of
+// the first elements are aligned. with numa placement on, blocks are aligned
+// and padded to whole pages instead, see numa_placement.hpp.
+#ifndef ALIGNED_ALLOCATOR_HPP
+#define ALIGNED_ALLOCATOR_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <algorithm>
+
+const size_t cache_line_size = 64;
+
+// alignment of the blocks allocated from now on, at least the Align of the
+// allocator. numa placement raises it to the page size, so that every block
+// owns whole pages that can be bound to its domain
+inline size_t& block_alignment()
+{
+    static size_t alignment = cache_line_size;
+    return alignment;
+}
+
+// number of doubles per row of a blocked layout including the padding to
+// whole cache lines
+inline size_t padded_stride( const size_t cols )
+{
+    const size_t n = cache_line_size / sizeof( double );
+    return ( ( cols + n - 1 ) / n ) * n;
+}
+
+template< class T , size_t Align = cache_line_size >
+struct aligned_allocator
+{
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template< class U >
+    struct rebind
+    {
+        typedef aligned_allocator< U , Align > other;
+    };
+
+    aligned_allocator() { }
+
+    template< class U >
+    aligned_allocator( const aligned_allocator< U , Align > & ) { }
+
+    T* allocate( const size_t n , const void* = 0 )
+    {
+        // round up to whole cache lines, or pages
+        const size_t align = std::max( Align , block_alignment() );
+        const size_t bytes = ( ( n*sizeof(T) + align - 1 ) / align ) * align;
+        void *p = 0;
+        if( posix_memalign( &p , align , bytes ) != 0 )
+            throw std::bad_alloc();
+        return static_cast< T* >( p );
+    }
+
+    void deallocate( T *p , const size_t )
+    {
+        free( p );
+    }
+
+    size_t max_size() const
+    {
+        return size_t(-1) / sizeof(T);
+    }
+
+    template< class U , class... Args >
+    void construct( U *p , Args&&... args )
+    {
+        ::new( static_cast< void* >( p ) ) U( std::forward< Args >( args )... );
+    }
+
+    template< class U >
+    void destroy( U *p )
+    {
+        p->~U();
+    }
+};
+
+template< class T , class U , size_t Align >
+bool operator==( const aligned_allocator< T , Align > & , const aligned_allocator< U , Align > & )
+{
+    return true;
+}
+
+template< class T , class U , size_t Align >
+bool operator!=( const aligned_allocator< T , Align > & , const aligned_allocator< U , Align > & )
+{
+    return false;
+}
+
+// the block type of the 1d chains and the rows of the 2d lattices
+typedef std::vector< double , aligned_allocator< double > > aligned_dvec;
+// blocks of the 1d chain stored in single precision
+typedef std::vector< float , aligned_allocator< float > > aligned_fvec;
+
+#endif
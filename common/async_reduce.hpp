@@ -0,0 +1,41 @@
+// Copyright 2013 Mario Mulansky
+// asynchronous reduction of futures in a binary tree of dataflows
+#ifndef ASYNC_REDUCE_HPP
+#define ASYNC_REDUCE_HPP
+
+#include <vector>
+
+#include <hpx/lcos/future.hpp>
+#include <hpx/lcos/local/dataflow.hpp>
+#include <hpx/util/unwrapped.hpp>
+
+struct add_values
+{
+    double operator()( const double a , const double b ) const
+    {
+        return a+b;
+    }
+};
+
+// sum of the values of x, returns without waiting for any of them. the sum
+// of no values is 0.
+template< class Future >
+Future tree_sum( std::vector< Future > x )
+{
+    if( x.empty() )
+        return hpx::make_ready_future( 0.0 );
+    while( x.size() > 1 )
+    {
+        std::vector< Future > y( (x.size()+1)/2 );
+        for( size_t i=0 ; i<x.size()/2 ; ++i )
+            y[i] = hpx::lcos::local::dataflow( hpx::launch::sync , 
+                                               hpx::util::unwrapped( add_values() ) , 
+                                               x[2*i] , x[2*i+1] );
+        if( x.size() % 2 == 1 )
+            y.back() = x.back();
+        x.swap( y );
+    }
+    return x[0];
+}
+
+#endif
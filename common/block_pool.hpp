@@ -0,0 +1,195 @@
+// Copyright 2013 Mario Mulansky
+// recycling pool for the data blocks of the futurized states.
+// blocks are handed out as shared_ptr whose deleter puts the block back into
+// the pool instead of freeing it, so stepper temporaries and repeated runs
+// reuse the memory of earlier blocks. released blocks go to a small cache of
+// the releasing thread first, the shared free list is only locked when the
+// cache is empty or full. blocks released after the cache of a thread is
+// destroyed at thread exit, e.g. blocks held by statics, go straight to the
+// shared list. the contents of a recycled block are undefined, its capacity
+// is kept.
+// blocks placed on a numa domain other than 0 are kept in a locked free list
+// of their domain and are only handed out again for that domain, so a
+// recycled block keeps its pages where they are bound. domain 0 is the only
+// one with placement off and uses the thread caches.
+#ifndef BLOCK_POOL_HPP
+#define BLOCK_POOL_HPP
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+template< class Block >
+class block_pool
+{
+public:
+
+    typedef std::shared_ptr< Block > pointer;
+
+    // number of blocks kept in the cache of each thread
+    static const size_t cache_size = 64;
+
+    static block_pool& instance()
+    {
+        static block_pool pool;
+        return pool;
+    }
+
+    pointer acquire( const size_t domain = 0 )
+    {
+        Block *b = ( domain == 0 ) ? pop() : pop( domain );
+        if( b == 0 )
+        {
+            b = new Block();
+            ++m_allocated;
+        }
+        else
+            ++m_reused;
+        return pointer( b , releaser( this , domain ) );
+    }
+
+    // number of blocks allocated with new
+    size_t allocated() const { return m_allocated; }
+    // number of blocks handed out from the pool
+    size_t reused() const { return m_reused; }
+
+    ~block_pool()
+    {
+        for( size_t i=0 ; i<m_free.size() ; ++i )
+            delete m_free[i];
+        for( size_t d=0 ; d<m_domain_free.size() ; ++d )
+            for( size_t i=0 ; i<m_domain_free[d].size() ; ++i )
+                delete m_domain_free[d][i];
+    }
+
+private:
+
+    struct releaser
+    {
+        block_pool *m_pool;
+        size_t m_domain;
+
+        releaser( block_pool *pool , const size_t domain )
+            : m_pool( pool ) , m_domain( domain )
+        { }
+
+        void operator()( Block *b ) const
+        {
+            if( m_domain == 0 )
+                m_pool->push( b );
+            else
+                m_pool->push( b , m_domain );
+        }
+    };
+
+    struct thread_cache
+    {
+        std::vector< Block* > m_blocks;
+
+        ~thread_cache()
+        {
+            block_pool &pool = instance();
+            std::lock_guard< std::mutex > lock( pool.m_mutex );
+            pool.m_free.insert( pool.m_free.end() , m_blocks.begin() , m_blocks.end() );
+            s_cache_gone = true;
+        }
+    };
+
+    block_pool()
+        : m_allocated( 0 ) , m_reused( 0 )
+    { }
+
+    // the cache of the calling thread, 0 once it is destroyed
+    static std::vector< Block* >* local_blocks()
+    {
+        if( s_cache_gone )
+            return 0;
+        static thread_local thread_cache cache;
+        return &cache.m_blocks;
+    }
+
+    Block* pop()
+    {
+        std::vector< Block* > *cache = local_blocks();
+        if( cache == 0 )
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            if( m_free.empty() )
+                return 0;
+            Block *b = m_free.back();
+            m_free.pop_back();
+            return b;
+        }
+        std::vector< Block* > &local = *cache;
+        if( local.empty() )
+        {
+            // refill half of the cache from the shared list
+            std::lock_guard< std::mutex > lock( m_mutex );
+            const size_t n = std::min( m_free.size() , cache_size/2 );
+            local.insert( local.end() , m_free.end()-n , m_free.end() );
+            m_free.resize( m_free.size()-n );
+        }
+        if( local.empty() )
+            return 0;
+        Block *b = local.back();
+        local.pop_back();
+        return b;
+    }
+
+    Block* pop( const size_t domain )
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        if( domain >= m_domain_free.size() || m_domain_free[domain].empty() )
+            return 0;
+        Block *b = m_domain_free[domain].back();
+        m_domain_free[domain].pop_back();
+        return b;
+    }
+
+    void push( Block *b , const size_t domain )
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        if( domain >= m_domain_free.size() )
+            m_domain_free.resize( domain+1 );
+        m_domain_free[domain].push_back( b );
+    }
+
+    void push( Block *b )
+    {
+        std::vector< Block* > *cache = local_blocks();
+        if( cache == 0 )
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_free.push_back( b );
+            return;
+        }
+        std::vector< Block* > &local = *cache;
+        if( local.size() >= cache_size )
+        {
+            // move half of the cache to the shared list
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_free.insert( m_free.end() , local.end()-cache_size/2 , local.end() );
+            local.resize( local.size()-cache_size/2 );
+        }
+        local.push_back( b );
+    }
+
+    std::mutex m_mutex;
+    std::vector< Block* > m_free;
+    // free lists of the domains > 0, index 0 is unused
+    std::vector< std::vector< Block* > > m_domain_free;
+    std::atomic< size_t > m_allocated;
+    std::atomic< size_t > m_reused;
+
+    // set by the destructor of the cache, trivially destructible so it stays
+    // valid until the thread is gone
+    static thread_local bool s_cache_gone;
+};
+
+template< class Block >
+thread_local bool block_pool< Block >::s_cache_gone = false;
+
+#endif
@@ -0,0 +1,288 @@
+// Copyright 2013 Mario Mulansky
+// force evaluation of one block of the 1d chain, vectorized with AVX2 or
+// AVX-512 if the cpu supports it (compile with -DNO_SIMD to disable)
+#ifndef CHAIN_KERNELS_HPP
+#define CHAIN_KERNELS_HPP
+
+#include <cstddef>
+#include <cmath>
+
+#include "simd_isa.hpp"
+#include "exponent_policy.hpp"
+
+#ifdef HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace chain_kernels {
+
+using std::size_t;
+
+namespace scalar {
+
+// K and L are the exponent policies of the on-site and coupling forces
+template< class K , class L >
+inline void block_rhs( const double *q , double *dpdt , const size_t N ,
+                       const double q_l , const double q_r ,
+                       const K k , const L l )
+{
+    dpdt[0] = l.signed_pow( q_l - q[0] );
+    for( size_t i=1 ; i<N ; ++i )
+        dpdt[i] = l.signed_pow( q[i-1] - q[i] );
+    const double c_N = l.signed_pow( q[N-1] - q_r );
+    for( size_t i=0 ; i<N-1 ; ++i )
+        dpdt[i] = -k.signed_pow( q[i] ) + dpdt[i] - dpdt[i+1];
+    dpdt[N-1] = -k.signed_pow( q[N-1] ) + dpdt[N-1] - c_N;
+}
+
+}
+
+#ifdef HAVE_X86_SIMD
+
+#if defined(__clang__)
+#pragma clang attribute push( __attribute__((target("avx2,fma"))) , apply_to = function )
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+struct avx2_ops
+{
+    typedef __m256d vec;
+    typedef __m256d mask;
+    static const size_t width = 4;
+
+    static vec load( const double *p ) { return _mm256_loadu_pd( p ); }
+    static void store( double *p , const vec x ) { _mm256_storeu_pd( p , x ); }
+    static vec set1( const double x ) { return _mm256_set1_pd( x ); }
+    static vec zero() { return _mm256_setzero_pd(); }
+    static double first( const vec x ) { return _mm256_cvtsd_f64( x ); }
+
+    static vec add( const vec a , const vec b ) { return _mm256_add_pd( a , b ); }
+    static vec sub( const vec a , const vec b ) { return _mm256_sub_pd( a , b ); }
+    static vec mul( const vec a , const vec b ) { return _mm256_mul_pd( a , b ); }
+    static vec div( const vec a , const vec b ) { return _mm256_div_pd( a , b ); }
+    static vec sqrt( const vec x ) { return _mm256_sqrt_pd( x ); }
+    static vec min( const vec a , const vec b ) { return _mm256_min_pd( a , b ); }
+    static vec max( const vec a , const vec b ) { return _mm256_max_pd( a , b ); }
+    // a*b+c and c-a*b
+    static vec fmadd( const vec a , const vec b , const vec c ) { return _mm256_fmadd_pd( a , b , c ); }
+    static vec fnmadd( const vec a , const vec b , const vec c ) { return _mm256_fnmadd_pd( a , b , c ); }
+    static vec round( const vec x ) { return _mm256_round_pd( x , _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC ); }
+
+    static vec abs( const vec x ) { return _mm256_andnot_pd( _mm256_set1_pd( -0.0 ) , x ); }
+    static vec copysign( const vec x , const vec s )
+    { return _mm256_or_pd( abs( x ) , _mm256_and_pd( _mm256_set1_pd( -0.0 ) , s ) ); }
+
+    static mask eq( const vec a , const vec b ) { return _mm256_cmp_pd( a , b , _CMP_EQ_OQ ); }
+    static mask lt( const vec a , const vec b ) { return _mm256_cmp_pd( a , b , _CMP_LT_OQ ); }
+    static mask gt( const vec a , const vec b ) { return _mm256_cmp_pd( a , b , _CMP_GT_OQ ); }
+    // m ? b : a
+    static vec blend( const vec a , const vec b , const mask m ) { return _mm256_blendv_pd( a , b , m ); }
+
+    // unbiased exponent of positive, normal x as double
+    static vec exponent( const vec x )
+    {
+        const __m256i e = _mm256_srli_epi64( _mm256_castpd_si256( x ) , 52 );
+        // 2^52 + e - (2^52 + 1023)
+        const vec magic = _mm256_set1_pd( 4503599627370496.0 );
+        return _mm256_sub_pd( _mm256_or_pd( _mm256_castsi256_pd( e ) , magic ) ,
+                              _mm256_set1_pd( 4503599627370496.0 + 1023.0 ) );
+    }
+    // mantissa of positive x in [1,2)
+    static vec mantissa( const vec x )
+    {
+        const __m256i bits = _mm256_and_si256( _mm256_castpd_si256( x ) ,
+                                               _mm256_set1_epi64x( 0x000FFFFFFFFFFFFFll ) );
+        return _mm256_castsi256_pd( _mm256_or_si256( bits , _mm256_set1_epi64x( 0x3FF0000000000000ll ) ) );
+    }
+    // x*2^n for integral n in [-1022,1023]
+    static vec scale( const vec x , const vec n )
+    {
+        const vec biased = _mm256_add_pd( n , _mm256_set1_pd( 4503599627370496.0 + 1023.0 ) );
+        return _mm256_mul_pd( x , _mm256_castsi256_pd( _mm256_slli_epi64( _mm256_castpd_si256( biased ) , 52 ) ) );
+    }
+};
+
+#define SIMD_OPS avx2_ops
+#define SIMD_NAMESPACE avx2
+#include "chain_kernels_simd_impl.hpp"
+#undef SIMD_OPS
+#undef SIMD_NAMESPACE
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push( __attribute__((target("avx512f"))) , apply_to = function )
+#else
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+struct avx512_ops
+{
+    typedef __m512d vec;
+    typedef __mmask8 mask;
+    static const size_t width = 8;
+
+    // the unmasked forms of several intrinsics take _mm512_undefined_pd() as
+    // their source, which gcc reports as used uninitialized wherever they are
+    // inlined. the masked forms with all lanes set and x as source are the
+    // same instructions.
+    static mask all() { return static_cast< mask >( 0xFF ); }
+
+    static vec load( const double *p ) { return _mm512_loadu_pd( p ); }
+    static void store( double *p , const vec x ) { _mm512_storeu_pd( p , x ); }
+    static vec set1( const double x ) { return _mm512_set1_pd( x ); }
+    static vec zero() { return _mm512_setzero_pd(); }
+    static double first( const vec x ) { return _mm512_cvtsd_f64( x ); }
+
+    static vec add( const vec a , const vec b ) { return _mm512_add_pd( a , b ); }
+    static vec sub( const vec a , const vec b ) { return _mm512_sub_pd( a , b ); }
+    static vec mul( const vec a , const vec b ) { return _mm512_mul_pd( a , b ); }
+    static vec div( const vec a , const vec b ) { return _mm512_div_pd( a , b ); }
+    static vec sqrt( const vec x ) { return _mm512_mask_sqrt_pd( x , all() , x ); }
+    static vec min( const vec a , const vec b ) { return _mm512_mask_min_pd( a , all() , a , b ); }
+    static vec max( const vec a , const vec b ) { return _mm512_mask_max_pd( a , all() , a , b ); }
+    static vec fmadd( const vec a , const vec b , const vec c ) { return _mm512_fmadd_pd( a , b , c ); }
+    static vec fnmadd( const vec a , const vec b , const vec c ) { return _mm512_fnmadd_pd( a , b , c ); }
+    static vec round( const vec x ) { return _mm512_mask_roundscale_pd( x , all() , x , _MM_FROUND_TO_NEAREST_INT ); }
+
+    static vec abs( const vec x ) { return _mm512_abs_pd( x ); }
+    static vec copysign( const vec x , const vec s )
+    {
+        const __m512i sign = _mm512_set1_epi64( 0x8000000000000000ll );
+        const __m512i magnitude = _mm512_set1_epi64( 0x7fffffffffffffffll );
+        return _mm512_castsi512_pd( _mm512_or_si512( _mm512_and_si512( magnitude , _mm512_castpd_si512( x ) ) ,
+                                                     _mm512_and_si512( sign , _mm512_castpd_si512( s ) ) ) );
+    }
+
+    static mask eq( const vec a , const vec b ) { return _mm512_cmp_pd_mask( a , b , _CMP_EQ_OQ ); }
+    static mask lt( const vec a , const vec b ) { return _mm512_cmp_pd_mask( a , b , _CMP_LT_OQ ); }
+    static mask gt( const vec a , const vec b ) { return _mm512_cmp_pd_mask( a , b , _CMP_GT_OQ ); }
+    static vec blend( const vec a , const vec b , const mask m ) { return _mm512_mask_blend_pd( m , a , b ); }
+
+    static vec exponent( const vec x ) { return _mm512_mask_getexp_pd( x , all() , x ); }
+    static vec mantissa( const vec x ) { return _mm512_mask_getmant_pd( x , all() , x , _MM_MANT_NORM_1_2 , _MM_MANT_SIGN_zero ); }
+    static vec scale( const vec x , const vec n ) { return _mm512_mask_scalef_pd( x , all() , x , n ); }
+};
+
+#define SIMD_OPS avx512_ops
+#define SIMD_NAMESPACE avx512
+#include "chain_kernels_simd_impl.hpp"
+#undef SIMD_OPS
+#undef SIMD_NAMESPACE
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif // HAVE_X86_SIMD
+
+template< class K , class L >
+struct block_rhs_select
+{
+    typedef void (*type)( const double* , double* , size_t ,
+                          double , double , K , L );
+
+    static type select( const simd_isa isa )
+    {
+#ifdef HAVE_X86_SIMD
+        if( isa == simd_avx512 )
+            return &avx512::block_rhs< K , L >;
+        if( isa == simd_avx2 )
+            return &avx2::block_rhs< K , L >;
+#endif
+        return &scalar::block_rhs< K , L >;
+    }
+};
+
+inline simd_isa block_rhs_isa()
+{
+    static const simd_isa isa = detect_simd_isa();
+    return isa;
+}
+
+// forces dpdt[0..N-1] of the block q[0..N-1] with neighbor values q_l, q_r,
+// on-site force exponent k and coupling force exponent l (KAPPA-1 and LAMBDA-1)
+template< class K , class L >
+inline void block_rhs( const double *q , double *dpdt , const size_t N ,
+                       const double q_l , const double q_r ,
+                       const K k , const L l )
+{
+    static const typename block_rhs_select< K , L >::type f = 
+        block_rhs_select< K , L >::select( block_rhs_isa() );
+    f( q , dpdt , N , q_l , q_r , k , l );
+}
+
+inline void block_rhs( const double *q , double *dpdt , const size_t N ,
+                       const double q_l , const double q_r ,
+                       const double k , const double l )
+{
+    block_rhs( q , dpdt , N , q_l , q_r , real_exponent( k ) , real_exponent( l ) );
+}
+
+// number of values per chunk of the kernels below, the chunks are kept in
+// buffers on the stack
+const size_t block_chunk = 256;
+
+// momentum update p += c*dpdt(q) without storing dpdt: the block is swept
+// once in chunks whose forces stay in cache, each chunk takes its neighbors
+// in the block as halo values
+template< class K , class L >
+inline void block_kick( const double *q , double *p , const size_t N ,
+                        const double q_l , const double q_r ,
+                        const K k , const L l , const double c )
+{
+    double f[block_chunk];
+    for( size_t s=0 ; s<N ; s += block_chunk )
+    {
+        const size_t n = ( N-s < block_chunk ) ? N-s : block_chunk;
+        block_rhs( q+s , f , n , ( s > 0 ) ? q[s-1] : q_l , ( s+n < N ) ? q[s+n] : q_r , k , l );
+        for( size_t i=0 ; i<n ; ++i )
+            p[s+i] += c*f[i];
+    }
+}
+
+// forces of a block stored in single precision. the chunks are widened to
+// double, the forces are computed and rounded to float only when stored.
+template< class K , class L >
+inline void block_rhs( const float *q , float *dpdt , const size_t N ,
+                       const double q_l , const double q_r ,
+                       const K k , const L l )
+{
+    double x[block_chunk] , f[block_chunk];
+    for( size_t s=0 ; s<N ; s += block_chunk )
+    {
+        const size_t n = ( N-s < block_chunk ) ? N-s : block_chunk;
+        for( size_t i=0 ; i<n ; ++i )
+            x[i] = q[s+i];
+        block_rhs( x , f , n , ( s > 0 ) ? q[s-1] : q_l , ( s+n < N ) ? q[s+n] : q_r , k , l );
+        for( size_t i=0 ; i<n ; ++i )
+            dpdt[s+i] = float( f[i] );
+    }
+}
+
+// momentum update of a block stored in single precision, p is rounded to
+// float only when stored
+template< class K , class L >
+inline void block_kick( const float *q , float *p , const size_t N ,
+                        const double q_l , const double q_r ,
+                        const K k , const L l , const double c )
+{
+    double x[block_chunk] , f[block_chunk];
+    for( size_t s=0 ; s<N ; s += block_chunk )
+    {
+        const size_t n = ( N-s < block_chunk ) ? N-s : block_chunk;
+        for( size_t i=0 ; i<n ; ++i )
+            x[i] = q[s+i];
+        block_rhs( x , f , n , ( s > 0 ) ? q[s-1] : q_l , ( s+n < N ) ? q[s+n] : q_r , k , l );
+        for( size_t i=0 ; i<n ; ++i )
+            p[s+i] = float( p[s+i] + c*f[i] );
+    }
+}
+}
+
+#endif
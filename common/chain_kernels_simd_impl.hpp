@@ -0,0 +1,166 @@
+// Copyright 2013 Mario Mulansky
+// vectorized block kernels of the 1d chain, written once in terms of
+// SIMD_OPS and included by chain_kernels.hpp for every instruction set.
+// no include guard on purpose.
+
+namespace SIMD_NAMESPACE {
+
+typedef SIMD_OPS ops;
+typedef ops::vec vec;
+typedef ops::mask mask;
+
+const size_t width = ops::width;
+
+// ln(x) for positive, normal x
+inline vec log( const vec x )
+{
+    const vec one = ops::set1( 1.0 );
+    vec e = ops::exponent( x );
+    vec m = ops::mantissa( x );
+    // move m into [sqrt(1/2) , sqrt(2))
+    const mask big = ops::gt( m , ops::set1( 1.41421356237309504880 ) );
+    m = ops::blend( m , ops::mul( m , ops::set1( 0.5 ) ) , big );
+    e = ops::blend( e , ops::add( e , one ) , big );
+    // ln(m) = 2 atanh(t) with |t| < 0.172
+    const vec t = ops::div( ops::sub( m , one ) , ops::add( m , one ) );
+    const vec t2 = ops::mul( t , t );
+    vec p = ops::set1( 2.0/23 );
+    p = ops::fmadd( p , t2 , ops::set1( 2.0/21 ) );
+    p = ops::fmadd( p , t2 , ops::set1( 2.0/19 ) );
+    p = ops::fmadd( p , t2 , ops::set1( 2.0/17 ) );
+    p = ops::fmadd( p , t2 , ops::set1( 2.0/15 ) );
+    p = ops::fmadd( p , t2 , ops::set1( 2.0/13 ) );
+    p = ops::fmadd( p , t2 , ops::set1( 2.0/11 ) );
+    p = ops::fmadd( p , t2 , ops::set1( 2.0/9 ) );
+    p = ops::fmadd( p , t2 , ops::set1( 2.0/7 ) );
+    p = ops::fmadd( p , t2 , ops::set1( 2.0/5 ) );
+    p = ops::fmadd( p , t2 , ops::set1( 2.0/3 ) );
+    p = ops::fmadd( p , t2 , ops::set1( 2.0 ) );
+    const vec lo = ops::fmadd( e , ops::set1( 2.319046813846299558e-17 ) , ops::mul( t , p ) );
+    return ops::fmadd( e , ops::set1( 6.93147180559945286227e-01 ) , lo );
+}
+
+// e^z, flushes to zero below the normal range
+inline vec exp( const vec z )
+{
+    const vec zc = ops::min( ops::max( z , ops::set1( -708.39 ) ) , ops::set1( 709.08 ) );
+    const vec n = ops::round( ops::mul( zc , ops::set1( 1.44269504088896340736 ) ) );
+    vec r = ops::fnmadd( n , ops::set1( 6.93147180559945286227e-01 ) , zc );
+    r = ops::fnmadd( n , ops::set1( 2.319046813846299558e-17 ) , r );
+    // taylor series, |r| < 0.347
+    vec p = ops::set1( 1.0/6227020800.0 );
+    p = ops::fmadd( p , r , ops::set1( 1.0/479001600.0 ) );
+    p = ops::fmadd( p , r , ops::set1( 1.0/39916800.0 ) );
+    p = ops::fmadd( p , r , ops::set1( 1.0/3628800.0 ) );
+    p = ops::fmadd( p , r , ops::set1( 1.0/362880.0 ) );
+    p = ops::fmadd( p , r , ops::set1( 1.0/40320.0 ) );
+    p = ops::fmadd( p , r , ops::set1( 1.0/5040.0 ) );
+    p = ops::fmadd( p , r , ops::set1( 1.0/720.0 ) );
+    p = ops::fmadd( p , r , ops::set1( 1.0/120.0 ) );
+    p = ops::fmadd( p , r , ops::set1( 1.0/24.0 ) );
+    p = ops::fmadd( p , r , ops::set1( 1.0/6.0 ) );
+    p = ops::fmadd( p , r , ops::set1( 0.5 ) );
+    p = ops::fmadd( p , r , ops::set1( 1.0 ) );
+    p = ops::fmadd( p , r , ops::set1( 1.0 ) );
+    const vec res = ops::scale( p , n );
+    return ops::blend( res , ops::zero() , ops::lt( z , ops::set1( -708.39 ) ) );
+}
+
+// x^N by repeated squaring
+template< int N >
+struct ipow
+{
+    static vec apply( const vec x )
+    {
+        const vec h = ipow< N/2 >::apply( x );
+        return ( N%2 ) ? ops::mul( ops::mul( h , h ) , x ) : ops::mul( h , h );
+    }
+};
+
+template<>
+struct ipow< 1 >
+{
+    static vec apply( const vec x ) { return x; }
+};
+
+template<>
+struct ipow< 0 >
+{
+    static vec apply( const vec ) { return ops::set1( 1.0 ); }
+};
+
+// sign(x)*|x|^y with +0 for x = +-0 like checked_math, meant for y >= 1
+inline vec signed_pow( const vec x , const real_exponent y )
+{
+    const vec ax = ops::abs( x );
+    const vec r = exp( ops::mul( ops::set1( y.value() ) , log( ax ) ) );
+    return ops::blend( ops::copysign( r , x ) , ops::zero() , ops::eq( ax , ops::zero() ) );
+}
+
+template< int TwiceExp >
+inline vec signed_pow( const vec x , const half_integer_exponent< TwiceExp > )
+{
+    const vec ax = ops::abs( x );
+    vec r = ipow< TwiceExp/2 >::apply( ax );
+    if( TwiceExp%2 )
+        r = ops::mul( r , ops::sqrt( ax ) );
+    return ops::blend( ops::copysign( r , x ) , ops::zero() , ops::eq( ax , ops::zero() ) );
+}
+
+template< class Exponent >
+inline double signed_pow( const double x , const Exponent y )
+{
+    return ops::first( signed_pow( ops::set1( x ) , y ) );
+}
+
+// dpdt_i = -sp(q_i,k) + c_i - c_{i+1} with the bond forces c_i = sp(q_{i-1}-q_i,l)
+// and q_{-1} = q_l , q_N = q_r.
+// first pass stores c_0..c_{N-1} in dpdt, the second pass adds the on-site
+// term in place, reading c_{i+1} before it gets overwritten.
+template< class K , class L >
+inline void block_rhs( const double *q , double *dpdt , const size_t N ,
+                       const double q_l , const double q_r ,
+                       const K k , const L l )
+{
+    double a[width] , b[width] , c[width];
+
+    // bond forces
+    dpdt[0] = signed_pow( q_l - q[0] , l );
+    size_t i = 1;
+    for( ; i+width <= N ; i += width )
+        ops::store( dpdt+i , signed_pow( ops::sub( ops::load( q+i-1 ) , ops::load( q+i ) ) , l ) );
+    if( i < N )
+    {
+        for( size_t j=0 ; j<width ; ++j )
+        {
+            a[j] = ( i+j < N ) ? q[i+j-1] : 0.0;
+            b[j] = ( i+j < N ) ? q[i+j] : 0.0;
+        }
+        ops::store( c , signed_pow( ops::sub( ops::load( a ) , ops::load( b ) ) , l ) );
+        for( size_t j=0 ; i+j<N ; ++j )
+            dpdt[i+j] = c[j];
+    }
+    const double c_N = signed_pow( q[N-1] - q_r , l );
+
+    // on-site forces
+    i = 0;
+    for( ; i+width < N ; i += width )
+    {
+        const vec c_i = ops::load( dpdt+i );
+        const vec c_ip1 = ops::load( dpdt+i+1 );
+        const vec f = ops::sub( ops::sub( c_i , signed_pow( ops::load( q+i ) , k ) ) , c_ip1 );
+        ops::store( dpdt+i , f );
+    }
+    for( size_t j=0 ; j<width ; ++j )
+    {
+        a[j] = ( i+j < N ) ? q[i+j] : 0.0;
+        b[j] = ( i+j < N ) ? dpdt[i+j] : 0.0;
+        c[j] = ( i+j+1 < N ) ? dpdt[i+j+1] : c_N;
+    }
+    ops::store( a , ops::sub( ops::sub( ops::load( b ) , signed_pow( ops::load( a ) , k ) ) ,
+                              ops::load( c ) ) );
+    for( size_t j=0 ; i+j<N ; ++j )
+        dpdt[i+j] = a[j];
+}
+
+}
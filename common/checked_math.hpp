@@ -0,0 +1,34 @@
+// Copyright 2013 Mario Mulansky
+// pow and signed pow with 0**y = 0, written without branches so the
+// compiler can if-convert and vectorize the loops calling them.
+// results are bit-identical to the old versions using if( x==0.0 ) and
+// boost::math::sign, including signed zeros.
+#ifndef CHECKED_MATH_HPP
+#define CHECKED_MATH_HPP
+
+#include <cmath>
+
+namespace checked_math {
+
+    inline double pow( double x , double y )
+    {
+        using std::pow;
+        using std::abs;
+        const double r = pow( abs(x) , y );
+        // 0**y = 0, don't care for y = 0 or NaN
+        return ( x==0.0 ) ? 0.0 : r;
+    }
+
+    // sign(x)*|x|^k, +0 for x = +-0
+    inline double signed_pow( double x , double k )
+    {
+        using std::copysign;
+        const double r = copysign( pow( x , k ) , x );
+        return ( x==0.0 ) ? 0.0 : r;
+    }
+
+}
+
+using checked_math::signed_pow;
+
+#endif
@@ -0,0 +1,134 @@
+// Copyright 2013 Mario Mulansky
+// exponent policies for the potentials |x|^KAPPA and |x|^LAMBDA:
+// integer and half-integer exponents are known at compile time and evaluated
+// by multiplication chains plus one sqrt, all others use std::pow.
+#ifndef EXPONENT_POLICY_HPP
+#define EXPONENT_POLICY_HPP
+
+#include <cmath>
+
+#include "checked_math.hpp"
+
+// x^N by repeated squaring
+template< int N >
+struct static_pow
+{
+    static double apply( const double x )
+    {
+        const double h = static_pow< N/2 >::apply( x );
+        return ( N%2 ) ? h*h*x : h*h;
+    }
+};
+
+template<>
+struct static_pow< 1 >
+{
+    static double apply( const double x ) { return x; }
+};
+
+template<>
+struct static_pow< 0 >
+{
+    static double apply( const double ) { return 1.0; }
+};
+
+
+// exponent TwiceExp/2
+template< int TwiceExp >
+struct half_integer_exponent
+{
+    typedef half_integer_exponent< TwiceExp-2 > minus_one_type;
+
+    double value() const { return TwiceExp/2.0; }
+
+    minus_one_type minus_one() const { return minus_one_type(); }
+
+    // |x|^p
+    double pow( const double x ) const
+    {
+        using std::abs;
+        using std::sqrt;
+        const double ax = abs( x );
+        return ( TwiceExp%2 ) ? static_pow< TwiceExp/2 >::apply( ax ) * sqrt( ax )
+                              : static_pow< TwiceExp/2 >::apply( ax );
+    }
+
+    // sign(x)*|x|^p, +0 for x = +-0 like checked_math::signed_pow
+    double signed_pow( const double x ) const
+    {
+        return ( x==0.0 ) ? 0.0 : std::copysign( pow( x ) , x );
+    }
+};
+
+
+// exponent given at run time, constructible from a double
+struct real_exponent
+{
+    typedef real_exponent minus_one_type;
+
+    double m_p;
+
+    real_exponent( const double p )
+        : m_p( p )
+    { }
+
+    double value() const { return m_p; }
+
+    minus_one_type minus_one() const { return real_exponent( m_p-1 ); }
+
+    double pow( const double x ) const
+    {
+        return checked_math::pow( x , m_p );
+    }
+
+    double signed_pow( const double x ) const
+    {
+        return checked_math::signed_pow( x , m_p );
+    }
+};
+
+
+// runtime-to-template dispatch: dispatch_exponents( kappa , lambda , f ) calls
+// f with the half_integer_exponent policies if ( kappa , lambda ) is one of
+// the pairs that are actually run, otherwise with real_exponent for both.
+// the pairs are given as twice the exponents: 3.5/4.5 of the 1d chain and
+// 4/6 of the simple_ variants. each driver instantiates its system only for
+// these pairs and the real one, define EXPONENT_DISPATCH_PAIRS to change them.
+template< int TwiceKappa , int TwiceLambda , class Next = void >
+struct exponent_pair
+{
+    template< class F >
+    static void call( const double kappa , const double lambda , F &f )
+    {
+        if( 2.0*kappa == TwiceKappa && 2.0*lambda == TwiceLambda )
+            f( half_integer_exponent< TwiceKappa >() , half_integer_exponent< TwiceLambda >() );
+        else
+            Next::call( kappa , lambda , f );
+    }
+};
+
+template< int TwiceKappa , int TwiceLambda >
+struct exponent_pair< TwiceKappa , TwiceLambda , void >
+{
+    template< class F >
+    static void call( const double kappa , const double lambda , F &f )
+    {
+        if( 2.0*kappa == TwiceKappa && 2.0*lambda == TwiceLambda )
+            f( half_integer_exponent< TwiceKappa >() , half_integer_exponent< TwiceLambda >() );
+        else
+            f( real_exponent( kappa ) , real_exponent( lambda ) );
+    }
+};
+
+#ifndef EXPONENT_DISPATCH_PAIRS
+#define EXPONENT_DISPATCH_PAIRS exponent_pair< 7 , 9 , exponent_pair< 8 , 12 > >
+#endif
+
+// calls f( kappa_policy , lambda_policy )
+template< class F >
+void dispatch_exponents( const double kappa , const double lambda , F &f )
+{
+    EXPONENT_DISPATCH_PAIRS::call( kappa , lambda , f );
+}
+
+#endif
@@ -0,0 +1,69 @@
+// Copyright 2013 Mario Mulansky
+// symplectic nystroem stepper with a fused momentum stage. odeint's stepper
+// lets the system write dpdt and then updates p = p + b*dt*dpdt in a second
+// pass. here the system provides kick( q , p , c ) for p += c*dpdt(q), which
+// evaluates the force and updates p in one sweep, without dpdt. the
+// coefficients are taken from the odeint stepper Base, the coordinate stage
+// q += a*dt*p uses its algebra and operations.
+#ifndef FUSED_SYMPLECTIC_STEPPER_HPP
+#define FUSED_SYMPLECTIC_STEPPER_HPP
+
+#include <cstddef>
+
+#include <boost/ref.hpp>
+#include <boost/numeric/odeint/stepper/stepper_categories.hpp>
+
+#include "two_pass_symplectic_stepper.hpp"
+
+template< class Base >
+class fused_symplectic_stepper
+{
+public:
+
+    typedef typename Base::coef_type coef_type;
+    typedef typename Base::algebra_type algebra_type;
+    typedef typename Base::operations_type operations_type;
+    typedef typename Base::value_type value_type;
+    typedef typename Base::time_type time_type;
+    typedef typename Base::order_type order_type;
+    typedef boost::numeric::odeint::stepper_tag stepper_category;
+
+    fused_symplectic_stepper( const Base &base = Base() )
+        : m_coef_a( base.coef_a() ) , m_coef_b( base.coef_b() ) ,
+          m_order( base.order() ) , m_algebra( base.algebra() )
+    { }
+
+    order_type order() const { return m_order; }
+
+    // state is a pair of q and p wrapped in boost::ref
+    template< class System , class StateInOut >
+    void do_step( System system , const StateInOut &state , const time_type t , const time_type dt )
+    {
+        typedef typename boost::unwrap_reference< typename StateInOut::first_type >::type coor_type;
+        typedef typename boost::unwrap_reference< typename StateInOut::second_type >::type momentum_type;
+        coor_type &q = state.first;
+        momentum_type &p = state.second;
+        do_step( system , q , p , t , dt );
+    }
+
+    template< class System , class Coor , class Momentum >
+    void do_step( System system , Coor &q , Momentum &p , const time_type , const time_type dt )
+    {
+        typedef typename boost::unwrap_reference< System >::type system_type;
+        typedef typename operations_type::template scale_sum2< value_type , time_type > scale_sum2;
+        system_type &sys = system;
+        for( size_t l=0 ; l<m_coef_a.size() ; ++l )
+        {
+            for_each3_coordinates( m_algebra , q , q , p , scale_sum2( 1.0 , m_coef_a[l]*dt ) );
+            sys.kick( q , p , m_coef_b[l]*dt );
+        }
+    }
+
+private:
+    const coef_type m_coef_a;
+    const coef_type m_coef_b;
+    const order_type m_order;
+    algebra_type m_algebra;
+};
+
+#endif
@@ -0,0 +1,134 @@
+// Copyright 2013 Mario Mulansky
+// online tuning of the block size G.
+// trial( G ) has to re-block the state into blocks of G elements, integrate a
+// few steps of the actual run and return the wall time per step.
+// trial.exhausted() tells if the trials have used up all steps of the run,
+// the tuning stops there. starting from G, clamped to [G_min,G_max], the
+// block size is doubled as long as the time per step improves, if the first
+// doubling does not help it is halved instead. only block sizes in
+// [G_min,G_max] that divide N are tried. reblock_trial is such a trial for
+// the drivers that integrate a pair of q and p.
+#ifndef GRANULARITY_TUNER_HPP
+#define GRANULARITY_TUNER_HPP
+
+#include <iostream>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include <chrono>
+
+#include <boost/ref.hpp>
+#include <boost/numeric/odeint/integrate/integrate_n_steps.hpp>
+
+namespace detail {
+
+    inline bool valid_granularity( const size_t G , const size_t N ,
+                                   const size_t G_min , const size_t G_max )
+    {
+        return ( G >= G_min ) && ( G <= G_max ) && ( G > 0 ) && ( N % G == 0 );
+    }
+
+    // G clamped to [G_min,G_max] and lowered to the next divisor of N
+    inline size_t clamp_granularity( const size_t G , const size_t N ,
+                                     const size_t G_min , const size_t G_max )
+    {
+        size_t g = std::max< size_t >( std::min( std::max( G , G_min ) , G_max ) , 1 );
+        while( g > G_min && N % g != 0 )
+            --g;
+        return g;
+    }
+
+    template< class Trial >
+    double try_granularity( Trial &trial , const size_t G )
+    {
+        const double t = trial( G );
+        std::clog << "tuning G: " << G << ", time per step: " << t << std::endl;
+        return t;
+    }
+
+}
+
+// returns the best block size found, the state is left blocked with the
+// last G tried, or not touched if there are no steps for a trial
+template< class Trial >
+size_t tune_granularity( Trial &trial , const size_t N , const size_t G_start ,
+                         const size_t G_min , const size_t G_max )
+{
+    size_t G_best = detail::clamp_granularity( G_start , N , G_min , G_max );
+    if( trial.exhausted() )
+        return G_best;
+    double t_best = detail::try_granularity( trial , G_best );
+
+    bool improved = false;
+    for( size_t G = 2*G_best ; detail::valid_granularity( G , N , G_min , G_max ) && !trial.exhausted() ; G *= 2 )
+    {
+        const double t = detail::try_granularity( trial , G );
+        if( t >= t_best )
+            break;
+        t_best = t;
+        G_best = G;
+        improved = true;
+    }
+    if( !improved )
+    {
+        for( size_t G = G_best/2 ; detail::valid_granularity( G , N , G_min , G_max ) && !trial.exhausted() ; G /= 2 )
+        {
+            const double t = detail::try_granularity( trial , G );
+            if( t >= t_best )
+                break;
+            t_best = t;
+            G_best = G;
+        }
+    }
+    return G_best;
+}
+
+// sets the block size of q and p with blocking( x , G ), which re-blocks the
+// state or sets the chunk size of a loop schedule, and integrates m_steps
+// steps of the actual run, at most m_max_steps steps in all trials.
+// blocking.wait( x ) returns when the steps on x are done. a new stepper is used for every
+// trial, as its temporaries are sized for a fixed number of blocks.
+template< class Stepper , class System , class State , class Blocking >
+struct reblock_trial
+{
+    State &m_q;
+    State &m_p;
+    System m_system;
+    const Blocking m_blocking;
+    const double m_dt;
+    const size_t m_steps;
+    // steps of the whole run
+    const size_t m_max_steps;
+    // steps done so far
+    size_t m_steps_done;
+
+    reblock_trial( State &q , State &p , System system ,
+                   const double dt , const size_t steps , const size_t max_steps ,
+                   const Blocking blocking = Blocking() )
+        : m_q( q ) , m_p( p ) , m_system( system ) , m_blocking( blocking ) , m_dt( dt ) ,
+          m_steps( steps ) , m_max_steps( max_steps ) , m_steps_done( 0 )
+    { }
+
+    bool exhausted() const
+    {
+        return m_steps_done >= m_max_steps;
+    }
+
+    double operator()( const size_t G )
+    {
+        // the last trial may be shorter
+        const size_t steps = std::min( m_steps , m_max_steps - m_steps_done );
+        m_blocking( m_q , G );
+        m_blocking( m_p , G );
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        boost::numeric::odeint::integrate_n_steps( Stepper() , m_system ,
+                                                   std::make_pair( boost::ref(m_q) , boost::ref(m_p) ) ,
+                                                   m_steps_done*m_dt , m_dt , steps );
+        m_blocking.wait( m_q );
+        m_blocking.wait( m_p );
+        m_steps_done += steps;
+        return std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count() / steps;
+    }
+};
+
+#endif
@@ -0,0 +1,150 @@
+// Copyright 2013 Mario Mulansky
+// placement of the data blocks on the numa domains of a node. the blocks of a
+// state are split into contiguous ranges, one per domain, and the pages of
+// each block are bound to its home domain with mbind, independent of the
+// worker thread that touches them first. with placement on, blocks are
+// allocated page aligned and padded to whole pages, so each block owns its
+// pages and small blocks are bound as well. the block pool keeps a free list
+// per domain, so recycled blocks stay on their domain. bound pages that are
+// already touched are moved. placement is off by default and binds nothing on
+// nodes with a single domain. the tasks are scheduled by hpx, placement only
+// decides where the data lives.
+#ifndef NUMA_PLACEMENT_HPP
+#define NUMA_PLACEMENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#include "aligned_allocator.hpp"
+
+class numa_placement
+{
+public:
+
+    static numa_placement& instance()
+    {
+        static numa_placement placement;
+        return placement;
+    }
+
+    // has to be called before the blocks are allocated
+    void enable( const bool on )
+    {
+        m_enabled = on;
+        block_alignment() = on ? page_size() : cache_line_size;
+    }
+
+    bool enabled() const { return m_enabled; }
+
+    // number of numa domains of this node
+    size_t domains() const { return m_domains; }
+
+    // home domain of block i of n
+    size_t home( const size_t i , const size_t n ) const
+    {
+        return ( n > 0 ) ? ( i*m_domains ) / n : 0;
+    }
+
+    // domain block i of n is placed on, 0 with placement off
+    size_t domain( const size_t i , const size_t n ) const
+    {
+        return ( m_enabled && m_domains > 1 ) ? home( i , n ) : 0;
+    }
+
+    // binds the pages of b to domain d
+    template< class Block >
+    void place_on( Block &b , const size_t d ) const
+    {
+        if( m_enabled && m_domains > 1 && b.capacity() > 0 )
+            bind( b.data() , b.capacity()*sizeof( b[0] ) , d );
+    }
+
+    // number of pages of b that lie on domain d, the number of all pages of
+    // b is added to pages
+    template< class Block >
+    size_t pages_on( const Block &b , const size_t d , size_t &pages ) const
+    {
+        if( b.empty() )
+            return 0;
+        const uintptr_t page = page_size();
+        const uintptr_t begin = reinterpret_cast< uintptr_t >( b.data() ) / page * page;
+        const uintptr_t end = reinterpret_cast< uintptr_t >( b.data() + b.size() );
+        std::vector< void* > addresses;
+        for( uintptr_t a=begin ; a<end ; a += page )
+            addresses.push_back( reinterpret_cast< void* >( a ) );
+        pages += addresses.size();
+        std::vector< int > status( addresses.size() , -1 );
+#if defined( __linux__ ) && defined( SYS_move_pages )
+        // without target nodes move_pages only reports the node of each page
+        if( syscall( SYS_move_pages , 0 , addresses.size() , &addresses[0] , 0 , &status[0] , 0 ) != 0 )
+            return 0;
+#endif
+        size_t n = 0;
+        for( size_t k=0 ; k<status.size() ; ++k )
+            if( status[k] == int( d ) )
+                ++n;
+        return n;
+    }
+
+private:
+
+    numa_placement()
+        : m_enabled( false ) , m_domains( count_domains() )
+    { }
+
+    static size_t page_size()
+    {
+#ifdef __linux__
+        return sysconf( _SC_PAGESIZE );
+#else
+        return 4096;
+#endif
+    }
+
+    static size_t count_domains()
+    {
+        size_t n = 0;
+        for( ;; ++n )
+        {
+            std::ostringstream name;
+            name << "/sys/devices/system/node/node" << n << "/cpulist";
+            std::ifstream f( name.str().c_str() );
+            if( !f )
+                break;
+        }
+        return ( n > 0 ) ? n : 1;
+    }
+
+    // a page aligned block is padded to whole pages by the allocator, all its
+    // pages are bound. of other blocks, e.g. allocated before placement was
+    // turned on, only the whole pages inside are bound, the pages at the
+    // edges can be shared with the neighboring allocations
+    void bind( void *p , const size_t bytes , const size_t domain ) const
+    {
+#if defined( __linux__ ) && defined( SYS_mbind )
+        const uintptr_t page = page_size();
+        const uintptr_t a = reinterpret_cast< uintptr_t >( p );
+        const uintptr_t begin = ( a + page - 1 ) / page * page;
+        const uintptr_t end = ( a % page == 0 ) ? ( a + bytes + page - 1 ) / page * page 
+                                                : ( a + bytes ) / page * page;
+        if( end <= begin || domain >= 8*sizeof( unsigned long ) )
+            return;
+        const unsigned long mask = 1ul << domain;
+        // MPOL_BIND , MPOL_MF_MOVE
+        syscall( SYS_mbind , begin , end-begin , 2 , &mask , 8*sizeof( mask )+1 , 1 << 1 );
+#endif
+    }
+
+    bool m_enabled;
+    const size_t m_domains;
+};
+
+#endif
@@ -0,0 +1,51 @@
+// Copyright 2013 Mario Mulansky
+// cost-weighted partitioning of the chain into blocks of variable size.
+// the blocks are cut where the accumulated cost crosses multiples of
+// total_cost/M, so every block carries about the same cost.
+#ifndef PARTITION_HPP
+#define PARTITION_HPP
+
+#include <vector>
+#include <cstddef>
+
+// block sizes of M blocks with roughly equal cost,
+// every block has at least min_size sites (M*min_size <= cost.size())
+inline std::vector< size_t > partition_by_cost( const std::vector< double > &cost ,
+                                                const size_t M ,
+                                                const size_t min_size = 1 )
+{
+    const size_t N = cost.size();
+    double total = 0.0;
+    for( size_t i=0 ; i<N ; ++i )
+        total += cost[i];
+
+    std::vector< size_t > sizes( M , 0 );
+    size_t start = 0;
+    double acc = 0.0;
+    for( size_t m=0 ; m<M-1 ; ++m )
+    {
+        const double target = total*(m+1)/M;
+        // leave at least min_size sites for each of the remaining blocks
+        const size_t last = N - (M-m-1)*min_size;
+        size_t end = start;
+        while( end < last && ( end-start < min_size || acc + cost[end]/2 < target ) )
+            acc += cost[end++];
+        sizes[m] = end-start;
+        start = end;
+    }
+    sizes[M-1] = N-start;
+    return sizes;
+}
+
+// per-site cost from measured run times of the blocks,
+// each site gets the average time of its block
+inline std::vector< double > site_cost( const std::vector< size_t > &sizes ,
+                                        const std::vector< double > &block_times )
+{
+    std::vector< double > cost;
+    for( size_t m=0 ; m<sizes.size() ; ++m )
+        cost.insert( cost.end() , sizes[m] , block_times[m]/sizes[m] );
+    return cost;
+}
+
+#endif
@@ -0,0 +1,49 @@
+// Copyright 2013 Mario Mulansky
+// tests for quiescent blocks. in spreading runs most of the lattice starts
+// at q=p=0 where the force vanishes, blocks check their data and neighbor
+// values and skip the work while they are zero. the test stops at the first
+// non-zero value, so it is cheap for active blocks as well.
+#ifndef QUIESCENCE_HPP
+#define QUIESCENCE_HPP
+
+#include <vector>
+#include <cstddef>
+
+inline bool all_zero( const double *x , const size_t N )
+{
+    for( size_t i=0 ; i<N ; ++i )
+        if( x[i] != 0.0 )
+            return false;
+    return true;
+}
+
+inline bool all_zero( const float *x , const size_t N )
+{
+    for( size_t i=0 ; i<N ; ++i )
+        if( x[i] != 0.0f )
+            return false;
+    return true;
+}
+
+template< class Alloc >
+bool all_zero( const std::vector< double , Alloc > &x )
+{
+    return x.empty() || all_zero( &x[0] , x.size() );
+}
+
+template< class Alloc >
+bool all_zero( const std::vector< float , Alloc > &x )
+{
+    return x.empty() || all_zero( &x[0] , x.size() );
+}
+
+template< class Row , class Alloc >
+bool all_zero( const std::vector< Row , Alloc > &x )
+{
+    for( size_t i=0 ; i<x.size() ; ++i )
+        if( !all_zero( x[i] ) )
+            return false;
+    return true;
+}
+
+#endif
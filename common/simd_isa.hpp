@@ -0,0 +1,56 @@
+// Copyright 2013 Mario Mulansky
+// runtime detection of the vector instruction set used by the block kernels
+#ifndef SIMD_ISA_HPP
+#define SIMD_ISA_HPP
+
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(NO_SIMD) && defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define HAVE_X86_SIMD
+#endif
+
+enum simd_isa
+{
+    simd_scalar ,
+    simd_avx2 ,
+    simd_avx512
+};
+
+inline const char* simd_isa_name( const simd_isa isa )
+{
+    switch( isa )
+    {
+    case simd_avx512 : return "avx512";
+    case simd_avx2 : return "avx2";
+    default : return "scalar";
+    }
+}
+
+// best instruction set supported by this cpu, can be lowered (never raised)
+// by setting SIMD_ISA=scalar|avx2|avx512 in the environment
+inline simd_isa detect_simd_isa()
+{
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    simd_isa isa = simd_scalar;
+    if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) )
+        isa = simd_avx2;
+    if( __builtin_cpu_supports( "avx512f" ) )
+        isa = simd_avx512;
+
+    const char *env = std::getenv( "SIMD_ISA" );
+    if( env != 0 )
+    {
+        if( std::strcmp( env , "scalar" ) == 0 )
+            isa = simd_scalar;
+        else if( ( std::strcmp( env , "avx2" ) == 0 ) && ( isa > simd_avx2 ) )
+            isa = simd_avx2;
+    }
+    return isa;
+#else
+    return simd_scalar;
+#endif
+}
+
+#endif
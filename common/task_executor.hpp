@@ -0,0 +1,153 @@
+// Copyright 2013 Mario Mulansky
+// executors of the futurized algebra, resize and system. the same integration
+// code runs on several schedulers, chosen when the executor is constructed:
+//  - pool: the default thread pool, with the task classes of
+//    task_priority.hpp (the previous behavior)
+//  - sequential: every task runs synchronously in the thread that makes its
+//    inputs ready, the whole integration runs in one thread
+//  - fork_join: all tasks are async and every stage ends with a barrier,
+//    like a parallel for
+// the algebra and the system take an executor object, by default a copy of
+// the process wide one, which the drivers set from the command line. the
+// executor also sets the coarsening of the algebra: the updates of that many
+// consecutive blocks share one task, independent of the block size of the
+// rhs. the launched tasks are counted per class, and all futures made
+// through the executor, of synchronous dataflows and promises included, are
+// counted as well.
+#ifndef TASK_EXECUTOR_HPP
+#define TASK_EXECUTOR_HPP
+
+#include <string>
+#include <utility>
+#include <stdexcept>
+#include <atomic>
+#include <vector>
+#include <memory>
+
+#include <hpx/hpx.hpp>
+#include <hpx/lcos/local/dataflow.hpp>
+#include <hpx/lcos/local/promise.hpp>
+
+#include "task_priority.hpp"
+
+enum executor_kind { pool_executor , sequential_executor , fork_join_executor };
+
+class task_executor
+{
+public:
+
+    explicit task_executor( const executor_kind kind = pool_executor , const size_t coarsening = 1 )
+        : m_kind( kind ) , m_coarsening( ( coarsening > 0 ) ? coarsening : 1 )
+    { }
+
+    // the process wide executor, used by default and for resizing
+    static task_executor& instance()
+    {
+        static task_executor executor;
+        return executor;
+    }
+
+    executor_kind kind() const { return m_kind; }
+
+    // number of consecutive blocks whose algebra updates share one task
+    size_t coarsening() const { return m_coarsening; }
+
+    // number of tasks of class c launched by all executors
+    static size_t tasks( const task_class c ) { return counter( c ); }
+
+    // number of futures made by all executors: of tasks, sync dataflows and promises
+    static size_t futures() { return future_counter(); }
+
+    static void reset_tasks()
+    {
+        counter( halo_task ) = 0;
+        counter( update_task ) = 0;
+        counter( bulk_task ) = 0;
+        future_counter() = 0;
+    }
+
+    // true if a task of class c runs as a task of its own, not in the
+    // thread that makes its inputs ready
+    bool async( const task_class c ) const
+    {
+        if( m_kind == sequential_executor )
+            return false;
+        if( m_kind == fork_join_executor )
+            return true;
+        return ( c == bulk_task ) || ( c == halo_task && task_priorities::instance().enabled() );
+    }
+
+    // synchronous dataflow of light work on the futures ts: halo copies,
+    // fences and the binding of partial results
+    template< class F , class... Ts >
+    auto sync( F f , Ts&&... ts ) const
+        -> decltype( hpx::lcos::local::dataflow( hpx::launch::sync , f , std::forward< Ts >( ts )... ) )
+    {
+        ++future_counter();
+        return hpx::lcos::local::dataflow( hpx::launch::sync , f , std::forward< Ts >( ts )... );
+    }
+
+    // n promises for the n results of one task
+    template< class T >
+    std::shared_ptr< std::vector< hpx::lcos::local::promise< T > > > promises( const size_t n ) const
+    {
+        future_counter() += n;
+        return std::make_shared< std::vector< hpx::lcos::local::promise< T > > >( n );
+    }
+
+    // dataflow of f on the futures ts as a task of class c
+    template< class F , class... Ts >
+    auto operator()( const task_class c , F f , Ts&&... ts ) const
+        -> decltype( hpx::lcos::local::dataflow( hpx::launch::async , f , std::forward< Ts >( ts )... ) )
+    {
+        ++counter( c );
+        ++future_counter();
+        switch( m_kind )
+        {
+        case sequential_executor :
+            return hpx::lcos::local::dataflow( hpx::launch::sync , f , std::forward< Ts >( ts )... );
+        case fork_join_executor :
+            return hpx::lcos::local::dataflow( hpx::launch::async , f , std::forward< Ts >( ts )... );
+        default :
+            return spawn( c , f , std::forward< Ts >( ts )... );
+        }
+    }
+
+    // end of a stage that wrote s, waits for its tasks in fork-join mode
+    template< class S >
+    void stage( S &s ) const
+    {
+        if( m_kind == fork_join_executor )
+            hpx::lcos::wait_all( s );
+    }
+
+    static executor_kind parse( const std::string &name )
+    {
+        if( name == "pool" )
+            return pool_executor;
+        if( name == "sequential" )
+            return sequential_executor;
+        if( name == "fork_join" )
+            return fork_join_executor;
+        throw std::invalid_argument( "unknown executor: " + name );
+    }
+
+private:
+
+    static std::atomic< size_t >& counter( const task_class c )
+    {
+        static std::atomic< size_t > counts[3];
+        return counts[c];
+    }
+
+    static std::atomic< size_t >& future_counter()
+    {
+        static std::atomic< size_t > count;
+        return count;
+    }
+
+    executor_kind m_kind;
+    size_t m_coarsening;
+};
+
+#endif
@@ -0,0 +1,75 @@
+// Copyright 2013 Mario Mulansky
+// scheduling priorities of the tasks of the futurized systems. halo tasks
+// produce values that the neighboring blocks wait for, like the coordinate
+// updates of the steppers and the bonds at the block edges. update tasks are
+// the other updates of the algebra, e.g. of the momenta, which only feed
+// their own block. bulk tasks are the rest of the work of a block, like the
+// rhs of its interior. the halo copies themselves stay synchronous, they are
+// taken before the neighbors get updated.
+// with priorities on, halo tasks go to the high priority queues of the
+// scheduler and are taken before queued bulk work, so a block whose edge
+// gates two neighbors does not wait behind interior work. with priorities
+// off (the default) halo tasks run synchronously and bulk tasks are plain
+// async tasks, as before. update tasks are too light for a task of their
+// own, they always run synchronously.
+#ifndef TASK_PRIORITY_HPP
+#define TASK_PRIORITY_HPP
+
+#include <utility>
+
+#include <hpx/lcos/local/dataflow.hpp>
+#include <hpx/include/thread_executors.hpp>
+
+enum task_class { halo_task , update_task , bulk_task };
+
+class task_priorities
+{
+public:
+
+    typedef hpx::threads::executors::default_executor executor_type;
+
+    static task_priorities& instance()
+    {
+        static task_priorities priorities;
+        return priorities;
+    }
+
+    void enable( const bool on ) { m_enabled = on; }
+    bool enabled() const { return m_enabled; }
+
+    hpx::threads::thread_priority priority( const task_class c ) const
+    {
+        return ( c == halo_task ) ? hpx::threads::thread_priority_critical
+                                  : hpx::threads::thread_priority_normal;
+    }
+
+    executor_type executor( const task_class c ) const
+    {
+        return executor_type( priority( c ) );
+    }
+
+private:
+
+    task_priorities()
+        : m_enabled( false )
+    { }
+
+    bool m_enabled;
+};
+
+// dataflow of f on the futures ts as a task of class c
+template< class F , class... Ts >
+auto spawn( const task_class c , F f , Ts&&... ts )
+    -> decltype( hpx::lcos::local::dataflow( hpx::launch::async , f , std::forward< Ts >( ts )... ) )
+{
+    const task_priorities &p = task_priorities::instance();
+    if( c == update_task )
+        return hpx::lcos::local::dataflow( hpx::launch::sync , f , std::forward< Ts >( ts )... );
+    if( p.enabled() )
+        return hpx::lcos::local::dataflow( p.executor( c ) , f , std::forward< Ts >( ts )... );
+    if( c == halo_task )
+        return hpx::lcos::local::dataflow( hpx::launch::sync , f , std::forward< Ts >( ts )... );
+    return hpx::lcos::local::dataflow( hpx::launch::async , f , std::forward< Ts >( ts )... );
+}
+
+#endif
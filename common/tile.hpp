@@ -0,0 +1,134 @@
+// Copyright 2013 Mario Mulansky
+// contiguous row-major block of the 2d lattices. all rows of a tile live in
+// one aligned allocation, each row is padded to a whole number of cache
+// lines. the stencils walk through memory row after row instead of
+// following one heap pointer per row. operator[] returns a light-weight view
+// of a row, so tile[i][j] and tile[i].size() work as for vector< vector >.
+// the padding is zero when the shape changes and the linear updates keep it
+// zero, so operations may run over the full storage including the padding.
+#ifndef TILE_HPP
+#define TILE_HPP
+
+#include <cstddef>
+#include <algorithm>
+
+#include "aligned_allocator.hpp"
+#include "quiescence.hpp"
+
+template< class T >
+class row_view
+{
+public:
+
+    typedef T value_type;
+    typedef T* iterator;
+    typedef T* const_iterator;
+    typedef size_t size_type;
+
+    row_view( T *data , const size_t size )
+        : m_data( data ) , m_size( size )
+    { }
+
+    T& operator[]( const size_t j ) const { return m_data[j]; }
+
+    size_t size() const { return m_size; }
+
+    T* data() const { return m_data; }
+
+    iterator begin() const { return m_data; }
+    iterator end() const { return m_data + m_size; }
+
+private:
+    T *m_data;
+    size_t m_size;
+};
+
+class tile
+{
+public:
+
+    typedef row_view< double > row_type;
+    typedef row_view< const double > const_row_type;
+
+    tile()
+        : m_rows( 0 ) , m_cols( 0 ) , m_stride( 0 )
+    { }
+
+    tile( const size_t rows , const size_t cols , const double value = 0.0 )
+        : m_rows( 0 ) , m_cols( 0 ) , m_stride( 0 )
+    {
+        resize( rows , cols );
+        fill( value );
+    }
+
+    // the contents are undefined after a change of the shape, the capacity
+    // is kept so recycled tiles do not reallocate
+    void resize( const size_t rows , const size_t cols )
+    {
+        if( rows == m_rows && cols == m_cols )
+            return;
+        m_rows = rows;
+        m_cols = cols;
+        m_stride = padded_stride( cols );
+        m_data.assign( m_rows*m_stride , 0.0 );
+    }
+
+    // sets all entries, the padding stays zero
+    void fill( const double value )
+    {
+        for( size_t i=0 ; i<m_rows ; ++i )
+            std::fill( row_begin( i ) , row_begin( i ) + m_cols , value );
+    }
+
+    // number of rows
+    size_t size() const { return m_rows; }
+    size_t cols() const { return m_cols; }
+    size_t stride() const { return m_stride; }
+
+    row_type operator[]( const size_t i )
+    {
+        return row_type( row_begin( i ) , m_cols );
+    }
+
+    const_row_type operator[]( const size_t i ) const
+    {
+        return const_row_type( row_begin( i ) , m_cols );
+    }
+
+    // copy of row i, used for the halos
+    aligned_dvec row( const size_t i ) const
+    {
+        return aligned_dvec( row_begin( i ) , row_begin( i ) + m_cols );
+    }
+
+    // copy of column j, used for the halos of the 2d decomposition
+    aligned_dvec column( const size_t j ) const
+    {
+        aligned_dvec c( m_rows );
+        for( size_t i=0 ; i<m_rows ; ++i )
+            c[i] = row_begin( i )[j];
+        return c;
+    }
+
+    // the full storage of size()*stride() values
+    double* data() { return m_data.data(); }
+    const double* data() const { return m_data.data(); }
+
+private:
+
+    double* row_begin( const size_t i ) { return m_data.data() + i*m_stride; }
+    const double* row_begin( const size_t i ) const { return m_data.data() + i*m_stride; }
+
+    size_t m_rows;
+    size_t m_cols;
+    size_t m_stride;
+    aligned_dvec m_data;
+};
+
+// the padding is zero, so the whole storage can be tested at once
+inline bool all_zero( const tile &x )
+{
+    return x.size() == 0 || all_zero( x.data() , x.size()*x.stride() );
+}
+
+#endif
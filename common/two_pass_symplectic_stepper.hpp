@@ -0,0 +1,88 @@
+// Copyright 2013 Mario Mulansky
+// symplectic nystroem stepper with the two passes of odeint's stepper: the
+// coordinate stage q += a*dt*p, the system writes dpdt, the momentum stage
+// p += b*dt*dpdt. odeint's stepper makes both stages with the same algebra
+// call, here the coordinate stage goes through for_each3_coordinates, so an
+// algebra can schedule it before other work. the coefficients are taken from
+// the odeint stepper Base, the results are the same.
+#ifndef TWO_PASS_SYMPLECTIC_STEPPER_HPP
+#define TWO_PASS_SYMPLECTIC_STEPPER_HPP
+
+#include <cstddef>
+
+#include <boost/ref.hpp>
+#include <boost/numeric/odeint/stepper/stepper_categories.hpp>
+#include <boost/numeric/odeint/util/resizer.hpp>
+#include <boost/numeric/odeint/util/state_wrapper.hpp>
+
+// the coordinate stage q += a*dt*p. an algebra whose blocks wait for the
+// coordinates of their neighbors can overload it to schedule it earlier
+template< class Algebra , class S1 , class S2 , class S3 , class Op >
+void for_each3_coordinates( Algebra &algebra , S1 &s1 , const S2 &s2 , const S3 &s3 , Op op )
+{
+    algebra.for_each3( s1 , s2 , s3 , op );
+}
+
+template< class Base >
+class two_pass_symplectic_stepper
+{
+public:
+
+    typedef typename Base::coef_type coef_type;
+    typedef typename Base::algebra_type algebra_type;
+    typedef typename Base::operations_type operations_type;
+    typedef typename Base::value_type value_type;
+    typedef typename Base::time_type time_type;
+    typedef typename Base::order_type order_type;
+    typedef typename Base::momentum_deriv_type momentum_deriv_type;
+    typedef typename Base::wrapped_momentum_deriv_type wrapped_momentum_deriv_type;
+    typedef typename Base::resizer_type resizer_type;
+    typedef boost::numeric::odeint::stepper_tag stepper_category;
+
+    two_pass_symplectic_stepper( const Base &base = Base() )
+        : m_coef_a( base.coef_a() ) , m_coef_b( base.coef_b() ) ,
+          m_order( base.order() ) , m_algebra( base.algebra() )
+    { }
+
+    order_type order() const { return m_order; }
+
+    // state is a pair of q and p wrapped in boost::ref
+    template< class System , class StateInOut >
+    void do_step( System system , const StateInOut &state , const time_type t , const time_type dt )
+    {
+        typedef typename boost::unwrap_reference< typename StateInOut::first_type >::type coor_type;
+        typedef typename boost::unwrap_reference< typename StateInOut::second_type >::type momentum_type;
+        coor_type &q = state.first;
+        momentum_type &p = state.second;
+        do_step( system , q , p , t , dt );
+    }
+
+    template< class System , class Coor , class Momentum >
+    void do_step( System system , Coor &q , Momentum &p , const time_type , const time_type dt )
+    {
+        typedef typename boost::unwrap_reference< System >::type system_type;
+        typedef typename operations_type::template scale_sum2< value_type , time_type > scale_sum2;
+        system_type &sys = system;
+        m_resizer.adjust_size( p , [this]( const Momentum &x ) 
+        {
+            return boost::numeric::odeint::adjust_size_by_resizeability( m_dpdt , x ,
+                typename boost::numeric::odeint::is_resizeable< momentum_deriv_type >::type() );
+        } );
+        for( size_t l=0 ; l<m_coef_a.size() ; ++l )
+        {
+            for_each3_coordinates( m_algebra , q , q , p , scale_sum2( 1.0 , m_coef_a[l]*dt ) );
+            sys( q , m_dpdt.m_v );
+            m_algebra.for_each3( p , p , m_dpdt.m_v , scale_sum2( 1.0 , m_coef_b[l]*dt ) );
+        }
+    }
+
+private:
+    const coef_type m_coef_a;
+    const coef_type m_coef_b;
+    const order_type m_order;
+    algebra_type m_algebra;
+    resizer_type m_resizer;
+    wrapped_momentum_deriv_type m_dpdt;
+};
+
+#endif
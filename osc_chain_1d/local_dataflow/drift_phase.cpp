@@ -0,0 +1,226 @@
+// Copyright 2013 Mario Mulansky
+//
+// energy drift and run time of the co-located chain with double and with
+// float storage, integrated from the same initial condition. prints the
+// relative energy error of both runs every --interval steps. with --pairs the
+// chain of separate q and p states of perf is integrated instead.
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <cmath>
+
+#define HPX_LIMIT 6
+
+#include <hpx/hpx.hpp>
+#include <hpx/hpx_init.hpp>
+#include <hpx/lcos/local/dataflow.hpp>
+#include <hpx/lcos/async.hpp>
+#include <hpx/util/unwrapped.hpp>
+#include <hpx/include/iostreams.hpp>
+
+#include <boost/numeric/odeint.hpp>
+
+#include "local_dataflow_shared_resize.hpp"
+#include "local_dataflow_algebra.hpp"
+#include "local_dataflow_shared_operations.hpp"
+#include "initialize.hpp"
+#include "phase_state.hpp"
+
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/two_pass_symplectic_stepper.hpp"
+
+using hpx::lcos::shared_future;
+using hpx::lcos::wait_all;
+using hpx::make_ready_future;
+using hpx::lcos::local::dataflow;
+using hpx::util::unwrapped;
+
+using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
+using boost::numeric::odeint::integrate_n_steps;
+
+typedef aligned_dvec dvec;
+
+template< class T >
+struct drift_run
+{
+    typedef basic_phase_view< T > view_type;
+    typedef typename view_type::state_type state_type;
+    typedef typename view_type::block_type block_type;
+
+    typedef symplectic_rkn_sb3a_mclachlan< view_type ,
+                                           view_type ,
+                                           double ,
+                                           view_type ,
+                                           view_type ,
+                                           double ,
+                                           phase_algebra ,
+                                           phase_operations > stepper_type;
+
+    state_type m_x;
+    view_type m_q;
+    view_type m_p;
+    stepper_type m_stepper;
+    double m_e0;
+    double m_time;
+
+    drift_run( const dvec &p_init , const size_t G )
+        : m_x( p_init.size()/G ) , m_q( &m_x , coor_part ) , m_p( &m_x , momentum_part ) ,
+          m_time( 0.0 )
+    {
+        for( size_t i=0 ; i<m_x.size() ; ++i )
+        {
+            m_x[i] = make_ready_future( std::make_shared< block_type >( ) );
+            m_x[i] = dataflow( unwrapped( basic_initialize_phase< T >( p_init , i*G , G ) ) , m_x[i] );
+        }
+        m_e0 = energy( m_x , kappa_type() , lambda_type() ).get();
+    }
+
+    // integrates steps steps and returns the relative energy error
+    double operator()( const double t , const double dt , const size_t steps )
+    {
+        hpx::util::high_resolution_timer timer;
+        integrate_n_steps( boost::ref( m_stepper ) , osc_chain_phase< kappa_type , lambda_type , T >() ,
+                           std::make_pair( boost::ref(m_q) , boost::ref(m_p) ) ,
+                           t , dt , steps );
+        wait_all( m_x );
+        m_time += timer.elapsed();
+        return std::abs( energy( m_x , kappa_type() , lambda_type() ).get() - m_e0 ) / m_e0;
+    }
+};
+
+// the chain of separate q and p states, as in perf --float
+template< class T >
+struct pair_drift_run
+{
+    typedef std::vector< T , aligned_allocator< T > > block_type;
+    typedef std::vector< shared_future< std::shared_ptr< block_type > > > state_type;
+
+    typedef symplectic_rkn_sb3a_mclachlan< state_type ,
+                                           state_type ,
+                                           double ,
+                                           state_type ,
+                                           state_type ,
+                                           double ,
+                                           local_dataflow_algebra ,
+                                           local_dataflow_shared_operations > odeint_stepper_type;
+    typedef two_pass_symplectic_stepper< odeint_stepper_type > stepper_type;
+
+    state_type m_q;
+    state_type m_p;
+    double m_e0;
+    double m_time;
+
+    pair_drift_run( const dvec &p_init , const size_t G )
+        : m_q( p_init.size()/G ) , m_p( p_init.size()/G ) , m_time( 0.0 )
+    {
+        const size_t M = m_q.size();
+        for( size_t i=0 ; i<M ; ++i )
+        {
+            m_q[i] = make_ready_future( std::make_shared< block_type >( ) );
+            m_q[i] = dataflow( unwrapped( basic_initialize_zero< T >( G , i , M ) ) , m_q[i] );
+            m_p[i] = make_ready_future( std::make_shared< block_type >( ) );
+            m_p[i] = dataflow( unwrapped( basic_initialize_copy< T >( p_init , i*G , G ) ) , m_p[i] );
+        }
+        m_e0 = energy( m_q , m_p ).get();
+    }
+
+    // integrates steps steps and returns the relative energy error
+    double operator()( const double t , const double dt , const size_t steps )
+    {
+        hpx::util::high_resolution_timer timer;
+        integrate_n_steps( stepper_type() , osc_chain<>() ,
+                           std::make_pair( boost::ref(m_q) , boost::ref(m_p) ) ,
+                           t , dt , steps );
+        wait_all( m_q );
+        wait_all( m_p );
+        m_time += timer.elapsed();
+        return std::abs( energy( m_q , m_p ).get() - m_e0 ) / m_e0;
+    }
+};
+
+// integrates the double and the float run of Run side by side
+template< template< class > class Run >
+void compare_drift( const dvec &p_init , const size_t G , const size_t steps ,
+                    const size_t interval , const double dt )
+{
+    Run< double > run_d( p_init , G );
+    Run< float > run_f( p_init , G );
+
+    hpx::cout << "# t\tdrift double\tdrift float\n" << hpx::flush;
+    for( size_t n=0 ; n<steps ; n += interval )
+    {
+        const size_t s = std::min( interval , steps-n );
+        const double e_d = run_d( n*dt , dt , s );
+        const double e_f = run_f( n*dt , dt , s );
+        hpx::cout << (boost::format("%f\t%e\t%e\n") % ((n+s)*dt) % e_d % e_f) << hpx::flush;
+    }
+
+    hpx::cout << (boost::format("# run time double: %f , float: %f\n") % run_d.m_time % run_f.m_time) << hpx::flush;
+}
+
+int hpx_main(boost::program_options::variables_map& vm)
+{
+    const std::size_t N = vm["N"].as<std::size_t>();
+    const std::size_t G = vm["G"].as<std::size_t>();
+    const std::size_t steps = vm["steps"].as<std::size_t>();
+    const std::size_t interval = vm["interval"].as<std::size_t>();
+    const double dt = vm["dt"].as<double>();
+
+    dvec p_init( (N/G)*G );
+
+    std::uniform_real_distribution<double> distribution( -1.0 , 1.0 );
+    std::mt19937 engine( 0 ); // Mersenne twister MT19937
+    auto generator = std::bind(distribution, engine);
+
+    std::generate( p_init.begin() ,
+                   p_init.end() ,
+                   std::ref(generator) );
+
+    if( vm.count( "pairs" ) > 0 )
+        compare_drift< pair_drift_run >( p_init , G , steps , interval , dt );
+    else
+        compare_drift< drift_run >( p_init , G , steps , interval , dt );
+
+    return hpx::finalize();
+}
+
+
+int main( int argc , char* argv[] )
+{
+    boost::program_options::options_description
+       desc_commandline("Usage: " HPX_APPLICATION_STRING " [options]");
+
+    desc_commandline.add_options()
+        ( "N",
+          boost::program_options::value<std::size_t>()->default_value(1024),
+          "Dimension (1024)")
+        ;
+    desc_commandline.add_options()
+        ( "G",
+          boost::program_options::value<std::size_t>()->default_value(128),
+          "Block size (128)")
+        ;
+    desc_commandline.add_options()
+        ( "steps",
+          boost::program_options::value<std::size_t>()->default_value(1000),
+          "time steps (1000)")
+        ;
+    desc_commandline.add_options()
+        ( "interval",
+          boost::program_options::value<std::size_t>()->default_value(100),
+          "steps between two energy measurements (100)")
+        ;
+    desc_commandline.add_options()
+        ( "dt",
+          boost::program_options::value<double>()->default_value(0.01),
+          "step size (0.01)")
+        ;
+    desc_commandline.add_options()
+        ( "pairs",
+          "integrate the chain of separate q and p states instead of the co-located blocks")
+        ;
+
+    // Initialize and run HPX
+    return hpx::init(desc_commandline, argc, argv);
+}
@@ -2,45 +2,78 @@
 #define INITIALIZE_HPP
 
 #include <memory>
+#include <vector>
+#include <algorithm>
 
-typedef std::vector< double > dvec;
+#include "../../common/block_pool.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/numa_placement.hpp"
+
+typedef aligned_dvec dvec;
 typedef std::shared_ptr< dvec > shared_vec;
 
-struct initialize_zero
+// the initializers return a block from the pool, v is only a placeholder
+// that orders the initialization. the pages of the block are placed on the
+// home domain of its position in the chain. the blocks store values of type
+// T, the data to copy from is double.
+
+template< class T >
+struct basic_initialize_zero
 {
+    typedef std::vector< T , aligned_allocator< T > > block_type;
+    typedef std::shared_ptr< block_type > shared_block;
+
     const size_t m_N;
+    // position of the block in the state
+    const size_t m_block;
+    const size_t m_blocks;
 
-    initialize_zero( const size_t N )
-        : m_N( N )
+    basic_initialize_zero( const size_t N , const size_t block = 0 , const size_t blocks = 1 )
+        : m_N( N ) , m_block( block ) , m_blocks( blocks )
     { }
 
-    shared_vec operator()( shared_vec v ) const
+    shared_block operator()( shared_block ) const
     {
+        const numa_placement &numa = numa_placement::instance();
+        const size_t d = numa.domain( m_block , m_blocks );
+        shared_block v = block_pool< block_type >::instance().acquire( d );
         //hpx::cout << "initializing vector with zero ...\n" << hpx::flush;
         v->resize( m_N );
-        std::fill( v->begin() , v->end() , 0.0 );
+        std::fill( v->begin() , v->end() , T( 0 ) );
+        numa.place_on( *v , d );
         return v;
     }
 };
 
 
-struct initialize_copy
+template< class T >
+struct basic_initialize_copy
 {
+    typedef std::vector< T , aligned_allocator< T > > block_type;
+    typedef std::shared_ptr< block_type > shared_block;
+
     const dvec &m_data; // why no reference here?
     const size_t m_index;
     const size_t m_len;
 
-    initialize_copy( const dvec &data , const size_t index , const size_t len )
+    basic_initialize_copy( const dvec &data , const size_t index , const size_t len )
         : m_data( data ) , m_index( index ) , m_len( len )
     { }
 
-    shared_vec operator()( shared_vec v ) const
+    shared_block operator()( shared_block ) const
     {
+        const numa_placement &numa = numa_placement::instance();
+        const size_t d = numa.domain( m_index , m_data.size() );
+        shared_block v = block_pool< block_type >::instance().acquire( d );
         //hpx::cout << boost::format("initializing vector from data at index %d ...\n") % m_index << hpx::flush;
         v->resize( m_len );
         std::copy( &(m_data[m_index]) , &(m_data[m_index+m_len]) , v->begin() );
+        numa.place_on( *v , d );
         return v;
     }
 };
 
+typedef basic_initialize_zero< double > initialize_zero;
+typedef basic_initialize_copy< double > initialize_copy;
+
 #endif
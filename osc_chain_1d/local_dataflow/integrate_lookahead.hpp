@@ -0,0 +1,105 @@
+// Copyright 2013 Mario Mulansky
+// futurized integration with a bounded number of steps in flight.
+// integrate_n_steps generates the dataflow graph of all steps before anything
+// has to finish, so the number of live tasks and futures grows with the number
+// of steps. here graph generation of step n waits for step n-lookahead.
+#ifndef INTEGRATE_LOOKAHEAD_HPP
+#define INTEGRATE_LOOKAHEAD_HPP
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <fstream>
+
+#include <unistd.h>
+
+#include <boost/ref.hpp>
+
+#include <hpx/lcos/future.hpp>
+
+using hpx::lcos::shared_future;
+using hpx::lcos::wait_all;
+
+// sampled only when asked for, the samples cost a scan of the window and a
+// read of /proc, which should not be part of a timed run
+struct lookahead_stats
+{
+    // max number of unfinished block futures of q and p in the window,
+    // sampled when the window is full, before its oldest step is waited for
+    size_t peak_pending;
+    // max resident set size of the process in kB during this integration,
+    // sampled like peak_pending. unlike the lifetime peak of getrusage it
+    // shows the memory bound of the lookahead in every run, 0 if
+    // /proc/self/statm is not available
+    long peak_rss;
+};
+
+namespace detail {
+
+    template< class State >
+    size_t count_pending( const std::deque< State > &window )
+    {
+        size_t pending = 0;
+        for( size_t n=0 ; n<window.size() ; ++n )
+            for( size_t i=0 ; i<window[n].size() ; ++i )
+                if( !window[n][i].is_ready() )
+                    ++pending;
+        return pending;
+    }
+
+    // current resident set size in kB, the second field of /proc/self/statm
+    inline long current_rss()
+    {
+        long size = 0 , resident = 0;
+        std::ifstream statm( "/proc/self/statm" );
+        if( !( statm >> size >> resident ) )
+            return 0;
+        return resident * ( sysconf( _SC_PAGESIZE ) / 1024 );
+    }
+
+}
+
+// as integrate_n_steps( stepper , system , make_pair( ref(q) , ref(p) ) , t , dt , steps )
+// but with at most lookahead steps of graph in flight. returns when all steps
+// are finished. the peaks are sampled into stats if it is given.
+template< class Stepper , class System , class State >
+void integrate_n_steps_lookahead( Stepper stepper , System system ,
+                                  State &q , State &p ,
+                                  double t , const double dt ,
+                                  const size_t steps ,
+                                  const size_t lookahead ,
+                                  lookahead_stats *stats = 0 )
+{
+    // the final futures of q and p of the steps in flight
+    std::deque< State > window;
+    for( size_t n=0 ; n<steps ; ++n )
+    {
+        stepper.do_step( system , std::make_pair( boost::ref(q) , boost::ref(p) ) , t , dt );
+        t += dt;
+
+        State last( q );
+        last.insert( last.end() , p.begin() , p.end() );
+        window.push_back( last );
+
+        if( window.size() >= lookahead )
+        {
+            if( stats != 0 )
+            {
+                stats->peak_pending = std::max( stats->peak_pending , detail::count_pending( window ) );
+                stats->peak_rss = std::max( stats->peak_rss , detail::current_rss() );
+            }
+            wait_all( window.front() );
+            window.pop_front();
+        }
+    }
+    // a window that never filled up
+    if( stats != 0 && !window.empty() && window.size() < lookahead )
+    {
+        stats->peak_pending = std::max( stats->peak_pending , detail::count_pending( window ) );
+        stats->peak_rss = std::max( stats->peak_rss , detail::current_rss() );
+    }
+    wait_all( q );
+    wait_all( p );
+}
+
+#endif
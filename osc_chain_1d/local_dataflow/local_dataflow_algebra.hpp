@@ -2,27 +2,100 @@
 #ifndef DATAFLOW_SHARED_ALGEBRA_HPP
 #define DATAFLOW_SHARED_ALGEBRA_HPP
 
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+
 #include <hpx/lcos/local/dataflow.hpp>
+#include <hpx/lcos/local/promise.hpp>
 #include <hpx/util/unwrapped.hpp>
 
+#include "../../common/task_executor.hpp"
+
 using hpx::lcos::local::dataflow;
 using hpx::lcos::shared_future;
 using hpx::util::unwrapped;
 
+// the updates of a range of consecutive blocks in one task. each block is
+// passed on through its promise, without a dataflow per block
+template< class Op , class V >
+struct coarse_update
+{
+    typedef std::vector< hpx::lcos::local::promise< V > > promises_type;
+
+    const Op m_op;
+    const std::shared_ptr< promises_type > m_blocks;
+
+    coarse_update( const Op op , const std::shared_ptr< promises_type > &blocks )
+        : m_op( op ) , m_blocks( blocks )
+    { }
+
+    template< class V2 , class V3 >
+    void operator()( const std::vector< V > &x1 , const std::vector< V2 > &x2 ,
+                     const std::vector< V3 > &x3 ) const
+    {
+        for( size_t i=0 ; i<x1.size() ; ++i )
+            (*m_blocks)[i].set_value( m_op( x1[i] , x2[i] , x3[i] ) );
+    }
+};
+
 struct local_dataflow_algebra
 {
+    task_executor m_executor;
+
+    local_dataflow_algebra( const task_executor &executor = task_executor::instance() )
+        : m_executor( executor )
+    { }
 
-    //template< class S1 , class S2 , class S3 , class Op >
-    // for now just a single state  type
-    template< typename S , typename Op >
-    void for_each3( S &s1 , const S &s2 , const S &s3 , Op op )
+    // the states can differ in type, e.g. a versioned coordinate updated
+    // with a plain momentum. the updates are of class c, the caller knows if
+    // the neighbors wait for s1
+    template< typename S1 , typename S2 , typename S3 , typename Op >
+    void for_each3( const task_class c , S1 &s1 , const S2 &s2 , const S3 &s3 , Op op )
     {
         const size_t N = boost::size( s1 );
-        for( size_t i=0 ; i<N ; ++i )
+        const size_t k = m_executor.coarsening();
+        // coarsening saves tasks, synchronous updates gain nothing from it
+        if( k == 1 || !m_executor.async( c ) )
         {
-            s1[i] = dataflow( hpx::launch::sync , unwrapped(op) , s1[i] , s2[i] , s3[i] );
+            for( size_t i=0 ; i<N ; ++i )
+                s1[i] = m_executor( c , unwrapped(op) , s1[i] , s2[i] , s3[i] );
         }
+        else
+        {
+            // k blocks per task, a task of k whole blocks is bulk work
+            typedef typename std::decay< decltype( s1[0].get() ) >::type block_type;
+            for( size_t b=0 ; b<N ; b += k )
+            {
+                const size_t e = std::min( b+k , N );
+                const auto blocks = m_executor.template promises< block_type >( e-b );
+                m_executor( bulk_task , unwrapped( coarse_update< Op , block_type >( op , blocks ) ) ,
+                            S1( s1.begin()+b , s1.begin()+e ) ,
+                            S2( s2.begin()+b , s2.begin()+e ) ,
+                            S3( s3.begin()+b , s3.begin()+e ) );
+                for( size_t i=b ; i<e ; ++i )
+                    s1[i] = (*blocks)[i-b].get_future();
+            }
+        }
+        m_executor.stage( s1 );
+    }
+
+    // momentum updates, and the coordinate updates of odeint's stepper,
+    // which uses the same call for both
+    template< typename S1 , typename S2 , typename S3 , typename Op >
+    void for_each3( S1 &s1 , const S2 &s2 , const S3 &s3 , Op op )
+    {
+        for_each3( update_task , s1 , s2 , s3 , op );
     }
 };
 
+// the coordinate stage of the two pass and the fused stepper, the neighbors
+// wait for it
+template< typename S1 , typename S2 , typename S3 , typename Op >
+void for_each3_coordinates( local_dataflow_algebra &algebra , S1 &s1 , const S2 &s2 , const S3 &s3 , Op op )
+{
+    algebra.for_each3( halo_task , s1 , s2 , s3 , op );
+}
+
 #endif
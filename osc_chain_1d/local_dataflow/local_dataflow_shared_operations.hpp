@@ -5,7 +5,10 @@
 #include <vector>
 #include <memory>
 
-typedef std::vector< double > dvec;
+#include "../../common/quiescence.hpp"
+#include "../../common/aligned_allocator.hpp"
+
+typedef aligned_dvec dvec;
 typedef std::shared_ptr< dvec > shared_vec;
 
 struct local_dataflow_shared_operations
@@ -28,6 +31,9 @@ struct local_dataflow_shared_operations
         S1 operator() ( S1 x1 , const S2 x2 , const S3 x3 ) const
         {
             //hpx::cout << boost::format( "operation sizes: %d , %d ; %d , %d ; %d , %d\n") % (x1->size()) % (*x1)[0].size() % (x2->size()) % (*x2)[0].size() % (x3->size()) % (*x3)[0].size() << hpx::flush;
+            // in-place update with a zero increment, nothing to do
+            if( m_alpha1 == 1 && x1 == x2 && all_zero( *x3 ) )
+                return x1;
             for( size_t i=0 ; i<x1->size() ; ++i )
                 (*x1)[i] = m_alpha1*(*x2)[i] + m_alpha2*(*x3)[i];
             //hpx::cout << boost::format( "operation finished\n" ) << hpx::flush;
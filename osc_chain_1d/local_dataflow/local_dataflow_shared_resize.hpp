@@ -14,12 +14,17 @@
 #include <hpx/lcos/local/dataflow.hpp>
 #include <hpx/util/unwrapped.hpp>
 
+#include "../../common/block_pool.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/numa_placement.hpp"
+#include "../../common/task_executor.hpp"
+
 using hpx::lcos::shared_future;
 using hpx::make_ready_future;
 using hpx::lcos::local::dataflow;
 using hpx::util::unwrapped;
 
-typedef std::vector< double > dvec;
+typedef aligned_dvec dvec;
 typedef std::shared_ptr< dvec > shared_vec;
 typedef std::vector< shared_future< shared_vec > > state_type;
 
@@ -40,42 +45,59 @@ struct state_wrapper< state_type >
 };
     */
 
-template<>
-struct is_resizeable< state_type >
+// states of blocks of any value type T, double or float
+
+template< class T >
+struct is_resizeable< std::vector< shared_future< std::shared_ptr< std::vector< T , aligned_allocator< T > > > > > >
 {
     typedef boost::true_type type;
     const static bool value = type::value;
 };
 
-template<>
-struct same_size_impl< state_type , state_type >
+template< class T >
+struct same_size_impl< std::vector< shared_future< std::shared_ptr< std::vector< T , aligned_allocator< T > > > > > ,
+                       std::vector< shared_future< std::shared_ptr< std::vector< T , aligned_allocator< T > > > > > >
 {
-    static bool same_size( const state_type &x1 ,
-                           const state_type &x2 )
+    typedef std::vector< shared_future< std::shared_ptr< std::vector< T , aligned_allocator< T > > > > > state;
+
+    static bool same_size( const state &x1 ,
+                           const state &x2 )
     {
         // not quite complete...
         return ( ( x1.size() == x2.size() ) );
     }
 };
 
-template<>
-struct resize_impl< state_type , state_type >
+template< class T >
+struct resize_impl< std::vector< shared_future< std::shared_ptr< std::vector< T , aligned_allocator< T > > > > > ,
+                    std::vector< shared_future< std::shared_ptr< std::vector< T , aligned_allocator< T > > > > > >
 {
-    static void resize( state_type &x1 ,
-                        state_type x2 )
+    typedef std::vector< T , aligned_allocator< T > > block_type;
+    typedef std::shared_ptr< block_type > shared_block;
+    typedef std::vector< shared_future< shared_block > > state;
+
+    static void resize( state &x1 ,
+                        state x2 )
     {
         //std::cout << "resizing..." << std::endl;
         // allocate required memory
-        x1.resize( x2.size() );
-        for( size_t i=0 ; i < x2.size() ; ++i )
+        const size_t N = x2.size();
+        x1.resize( N );
+        for( size_t i=0 ; i < N ; ++i )
         {
-            x1[i] = dataflow( unwrapped([]( shared_vec v2 )
+            // temporaries live on the same domain as the block they belong to
+            x1[i] = task_executor::instance()( bulk_task , unwrapped([i,N]( shared_block v2 )
                 {
-                    shared_vec tmp = std::make_shared<dvec>( v2->size() );
+                    const numa_placement &numa = numa_placement::instance();
+                    const size_t d = numa.domain( i , N );
+                    shared_block tmp = block_pool< block_type >::instance().acquire( d );
+                    tmp->resize( v2->size() );
+                    numa.place_on( *tmp , d );
                     return tmp;
                 }) ,
                               x2[i] );
         }
+        task_executor::instance().stage( x1 );
         //std::cout << "resizing complete" << std::endl;
     }
 };
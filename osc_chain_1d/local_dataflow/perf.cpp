@@ -4,6 +4,7 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <stdexcept>
 
 #define HPX_LIMIT 6
 
@@ -22,6 +23,13 @@
 #include "local_dataflow_shared_operations.hpp"
 #include "initialize.hpp"
 #include "system.hpp"
+#include "integrate_lookahead.hpp"
+#include "reblock.hpp"
+#include "../../common/numa_placement.hpp"
+#include "../../common/task_executor.hpp"
+#include "../../common/granularity_tuner.hpp"
+#include "../../common/fused_symplectic_stepper.hpp"
+#include "../../common/aligned_allocator.hpp"
 
 using hpx::lcos::shared_future;
 using hpx::find_here;
@@ -34,83 +42,271 @@ using hpx::util::unwrapped;
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 using boost::numeric::odeint::integrate_n_steps;
 
-typedef std::vector< double > dvec;
+typedef aligned_dvec dvec;
 typedef std::shared_ptr< dvec > shared_vec;
 typedef std::vector< shared_future< shared_vec > > state_type;
 
-typedef symplectic_rkn_sb3a_mclachlan< state_type ,
-                                       state_type ,
+// state and steppers of the chain with blocks of T, double or float
+template< class T >
+struct chain_types
+{
+    typedef std::vector< T , aligned_allocator< T > > block_type;
+    typedef std::vector< shared_future< std::shared_ptr< block_type > > > state_type;
+
+    typedef symplectic_rkn_sb3a_mclachlan< state_type ,
+                                           state_type ,
+                                           double ,
+                                           state_type ,
+                                           state_type , 
+                                           double ,
+                                           local_dataflow_algebra ,
+                                           local_dataflow_shared_operations > odeint_stepper_type;
+
+    // the coordinate updates of both are halo tasks
+    typedef two_pass_symplectic_stepper< odeint_stepper_type > stepper_type;
+    typedef fused_symplectic_stepper< odeint_stepper_type > fused_stepper_type;
+};
+
+typedef symplectic_rkn_sb3a_mclachlan< graph_state ,
+                                       graph_state ,
                                        double ,
-                                       state_type ,
-                                       state_type , 
+                                       graph_state ,
+                                       graph_state , 
                                        double ,
-                                       local_dataflow_algebra ,
-                                       local_dataflow_shared_operations > stepper_type;
+                                       graph_algebra ,
+                                       local_dataflow_shared_operations > graph_stepper_type;
 
-int hpx_main(boost::program_options::variables_map& vm)
+// number of pages of the blocks of x that lie on the home domain of their
+// block, the number of all pages is added to pages
+template< class State >
+size_t pages_at_home( const State &x , size_t &pages )
 {
+    const numa_placement &numa = numa_placement::instance();
+    size_t n = 0;
+    for( size_t i=0 ; i<x.size() ; ++i )
+        n += numa.pages_on( *x[i].get() , numa.home( i , x.size() ) , pages );
+    return n;
+}
 
-
-    const std::size_t N = vm["N"].as<std::size_t>();
-    const std::size_t G = vm["G"].as<std::size_t>();
-    const std::size_t steps = vm["steps"].as<std::size_t>();
-    const double dt = vm["dt"].as<double>();
-    const std::size_t M = N/G;
-
-    double avrg_time = 0.0;
-    double min_time = 1000000.0;
-
-    for( size_t n=0 ; n<12 ; ++n )
+// records graph_steps steps once and replays them, steps is rounded up to a
+// multiple of graph_steps. returns the number of steps replayed.
+template< class Kappa , class Lambda >
+size_t replay_steps( state_type &q , state_type &p , const Kappa kappa , const Lambda lambda ,
+                     const double dt , const size_t graph_steps , const size_t steps )
+{
+    task_graph graph;
+    graph_stepper_type stepper;
+    capture( graph , stepper , osc_chain< Kappa , Lambda >( kappa , lambda ) ,
+             q , p , dt , graph_steps );
+    size_t steps_run = 0;
+    for( size_t s=0 ; s<steps ; s += graph_steps )
     {
+        graph.replay();
+        steps_run += graph_steps;
+    }
+    return steps_run;
+}
 
-        dvec p_init( N );
+// the task graph records blocks of double only
+template< class Kappa , class Lambda >
+size_t replay_steps( float_state_type & , float_state_type & , const Kappa , const Lambda ,
+                     const double , const size_t , const size_t )
+{
+    throw std::invalid_argument( "--graph_steps is not available with --float" );
+}
 
-        std::uniform_real_distribution<double> distribution( -1.0 , 1.0 );
-        std::mt19937 engine( 0 ); // Mersenne twister MT19937
-        auto generator = std::bind(distribution, engine);
+template< class T >
+struct perf_run
+{
+    typedef typename chain_types< T >::state_type state_type;
+    typedef typename chain_types< T >::stepper_type stepper_type;
+    typedef typename chain_types< T >::fused_stepper_type fused_stepper_type;
+
+    const std::size_t N;
+    const std::size_t G;
+    const std::size_t steps;
+    const double dt;
+    const std::size_t graph_steps;
+    const std::size_t lookahead;
+    const std::size_t tune_steps;
+    const bool fused;
+    const bool split_rhs;
+
+    double avrg_time;
+    double min_time;
+    // block size after tuning
+    std::size_t G_tuned;
+    // steps integrated in all runs, including the tuning trials
+    std::size_t steps_run;
+
+    perf_run( const std::size_t N_ , const std::size_t G_ , 
+              const std::size_t steps_ , const double dt_ ,
+              const std::size_t graph_steps_ , const std::size_t lookahead_ ,
+              const std::size_t tune_steps_ , const bool fused_ , const bool split_rhs_ )
+        : N( N_ ) , G( G_ ) , steps( steps_ ) , dt( dt_ ) , 
+          graph_steps( graph_steps_ ) , lookahead( lookahead_ ) , tune_steps( tune_steps_ ) ,
+          fused( fused_ ) , split_rhs( split_rhs_ ) ,
+          avrg_time( 0.0 ) , min_time( 1000000.0 ) , G_tuned( G_ ) , steps_run( 0 )
+    { }
+
+    template< class Kappa , class Lambda >
+    void operator()( const Kappa kappa , const Lambda lambda )
+    {
+        const std::size_t M = N/G;
+        const osc_chain< Kappa , Lambda > system( kappa , lambda , 0 , task_executor::instance() , split_rhs );
 
-        std::generate( p_init.begin() , 
-                       p_init.end() , 
-                       std::ref(generator) );
+        for( size_t n=0 ; n<12 ; ++n )
+        {
 
-        state_type q( M );
-        state_type p( M );
+            dvec p_init( N );
+
+            std::uniform_real_distribution<double> distribution( -1.0 , 1.0 );
+            std::mt19937 engine( 0 ); // Mersenne twister MT19937
+            auto generator = std::bind(distribution, engine);
+
+            std::generate( p_init.begin() , 
+                           p_init.end() , 
+                           std::ref(generator) );
+
+            state_type q( M );
+            state_type p( M );
+
+            for( size_t i=0 ; i<M ; ++i )
+            {
+                q[i] = make_ready_future( std::make_shared< typename chain_types< T >::block_type >( ) );
+                q[i] = dataflow( unwrapped(basic_initialize_zero< T >( G , i , M )) , q[i] );
+                p[i] = make_ready_future( std::make_shared< typename chain_types< T >::block_type >( ) );
+                p[i] = dataflow( unwrapped(basic_initialize_copy< T >( p_init , i*G , G )) , p[i] );
+            }
+
+            wait_all( q );
+            wait_all( p );
+
+            if( n == 0 )
+            {
+                size_t pages = 0;
+                const size_t home = pages_at_home( q , pages ) + pages_at_home( p , pages );
+                std::clog << "numa domains: " << numa_placement::instance().domains()
+                          << ", pages on home domain: " << home << " of " << pages << std::endl;
+            }
+
+            hpx::util::high_resolution_timer timer;
+
+            // the tuning trials are the first steps of the run
+            size_t steps_left = steps;
+            if( tune_steps > 0 )
+            {
+                reblock_trial< stepper_type , osc_chain< Kappa , Lambda > , state_type , reblocking > 
+                    trial( q , p , system , dt , tune_steps , steps );
+                G_tuned = tune_granularity( trial , N , G , 1 , N/hpx::get_os_thread_count() );
+                reblock( q , G_tuned );
+                reblock( p , G_tuned );
+                steps_left -= std::min( steps_left , trial.m_steps_done );
+                steps_run += trial.m_steps_done;
+            }
+
+            if( graph_steps > 0 )
+            {
+                steps_run += replay_steps( q , p , kappa , lambda , dt , graph_steps , steps_left );
+            }
+            else if( lookahead > 0 )
+            {
+                steps_run += steps_left;
+                // sampled in the first run only, which is not counted in
+                // the timings
+                lookahead_stats stats = { 0 , 0 };
+                integrate_n_steps_lookahead( stepper_type() , system ,
+                                             q , p , 0.0 , dt , steps_left , lookahead ,
+                                             ( n == 0 ) ? &stats : 0 );
+                if( n == 0 )
+                    std::clog << "peak pending futures: " << stats.peak_pending
+                              << ", peak rss of the run: " << stats.peak_rss << " kB" << std::endl;
+            }
+            else if( fused )
+            {
+                steps_run += steps_left;
+                integrate_n_steps( fused_stepper_type() , system , 
+                                   std::make_pair( boost::ref(q) , boost::ref(p) ) ,
+                                   0.0 , dt , steps_left );
+            }
+            else
+            {
+                steps_run += steps_left;
+                integrate_n_steps( stepper_type() , system , 
+                                   std::make_pair( boost::ref(q) , boost::ref(p) ) ,
+                                   0.0 , dt , steps_left );
+            }
+
+            //hpx::cout << "dataflow generation ready\n" << hpx::flush;
+
+            wait_all( q );
+            wait_all( p );
+
+            double run_time = timer.elapsed();
+
+            if( n > 1 )
+            {
+                avrg_time += run_time;
+                min_time = std::min( run_time , min_time );
+            }
+
+            std::clog << G_tuned << ", run: " << n << " run time: " << run_time << std::endl;
 
-        for( size_t i=0 ; i<M ; ++i )
-        {
-            q[i] = make_ready_future( std::make_shared<dvec>( ) );
-            q[i] = dataflow( unwrapped(initialize_zero( G )) , q[i] );
-            p[i] = make_ready_future( std::make_shared<dvec>( ) );
-            p[i] = dataflow( unwrapped(initialize_copy( p_init , i*G , G )) , p[i] );
         }
+    }
+};
 
-        wait_all( q );
-        wait_all( p );
+// runs the benchmark with blocks of T and prints the results
+template< class T >
+void run_perf( perf_run< T > &run , const double kappa , const double lambda )
+{
+    typedef typename chain_types< T >::block_type block_type;
 
-        hpx::util::high_resolution_timer timer;
+    dispatch_exponents( kappa , lambda , run );
 
-        integrate_n_steps( stepper_type() , osc_chain , 
-                           std::make_pair( boost::ref(q) , boost::ref(p) ) ,
-                           0.0 , dt , steps );
+    std::clog << "blocks allocated: " << block_pool< block_type >::instance().allocated() 
+              << ", reused: " << block_pool< block_type >::instance().reused() << std::endl;
+    // all 12 runs, replayed graphs launch no executor tasks
+    const double steps_run = std::max< std::size_t >( run.steps_run , 1 );
+    std::clog << "tasks per step, halo: " << double( task_executor::tasks( halo_task ) )/steps_run
+              << ", update: " << double( task_executor::tasks( update_task ) )/steps_run
+              << ", bulk: " << double( task_executor::tasks( bulk_task ) )/steps_run << std::endl;
+    std::clog << "futures per step made through the executor: " 
+              << double( task_executor::futures() )/steps_run << std::endl;
 
-        //hpx::cout << "dataflow generation ready\n" << hpx::flush;
+    hpx::cout << (boost::format("%d\t%f\t%f\n") % run.G_tuned % run.min_time % (run.avrg_time/10)) << hpx::flush;
+}
 
-        wait_all( q );
-        wait_all( p );
+int hpx_main(boost::program_options::variables_map& vm)
+{
+    const std::size_t N = vm["N"].as<std::size_t>();
+    const std::size_t G = vm["G"].as<std::size_t>();
+    const std::size_t steps = vm["steps"].as<std::size_t>();
+    const double dt = vm["dt"].as<double>();
+    const double kappa = vm["kappa"].as<double>();
+    const double lambda = vm["lambda"].as<double>();
+    const std::size_t graph_steps = vm["graph_steps"].as<std::size_t>();
+    const std::size_t lookahead = vm["lookahead"].as<std::size_t>();
+    const std::size_t tune_steps = vm["tune_steps"].as<std::size_t>();
 
-        double run_time = timer.elapsed();
+    numa_placement::instance().enable( vm.count( "numa" ) > 0 );
+    task_priorities::instance().enable( vm.count( "priorities" ) > 0 );
+    task_executor::instance() = task_executor( task_executor::parse( vm["executor"].as<std::string>() ) ,
+                                               vm["coarsening"].as<std::size_t>() );
 
-        if( n > 1 )
-        {
-            avrg_time += run_time;
-            min_time = std::min( run_time , min_time );
-        }
-
-        std::clog << G << ", run: " << n << " run time: " << run_time << std::endl;
+    const bool fused = vm.count( "fused" ) > 0;
+    const bool split_rhs = vm.count( "split_rhs" ) > 0;
 
+    if( vm.count( "float" ) > 0 )
+    {
+        perf_run< float > run( N , G , steps , dt , graph_steps , lookahead , tune_steps , fused , split_rhs );
+        run_perf( run , kappa , lambda );
+    }
+    else
+    {
+        perf_run< double > run( N , G , steps , dt , graph_steps , lookahead , tune_steps , fused , split_rhs );
+        run_perf( run , kappa , lambda );
     }
-
-    hpx::cout << (boost::format("%d\t%f\t%f\n") % G % min_time % (avrg_time/10)) << hpx::flush;
 
     return hpx::finalize();
 }
@@ -141,6 +337,61 @@ int main( int argc , char* argv[] )
           boost::program_options::value<double>()->default_value(0.01),
           "step size (0.01)")
         ;
+    desc_commandline.add_options()
+        ( "kappa",
+          boost::program_options::value<double>()->default_value(3.5),
+          "on-site exponent (3.5)")
+        ;
+    desc_commandline.add_options()
+        ( "lambda",
+          boost::program_options::value<double>()->default_value(4.5),
+          "coupling exponent (4.5)")
+        ;
+    desc_commandline.add_options()
+        ( "graph_steps",
+          boost::program_options::value<std::size_t>()->default_value(0),
+          "steps per captured task graph, 0 builds dataflows every step (0)")
+        ;
+    desc_commandline.add_options()
+        ( "lookahead",
+          boost::program_options::value<std::size_t>()->default_value(0),
+          "max number of steps in flight, 0 is unbounded (0)")
+        ;
+    desc_commandline.add_options()
+        ( "tune_steps",
+          boost::program_options::value<std::size_t>()->default_value(0),
+          "auto-tune G starting from --G with this many steps per trial, 0 is off (0)")
+        ;
+    desc_commandline.add_options()
+        ( "numa",
+          "place the blocks on the numa domains of their position in the chain")
+        ;
+    desc_commandline.add_options()
+        ( "fused",
+          "evaluate the forces and update the momenta in one task per block")
+        ;
+    desc_commandline.add_options()
+        ( "float",
+          "store the blocks in float, the forces are computed in double")
+        ;
+    desc_commandline.add_options()
+        ( "split_rhs",
+          "start the rhs of the block interior before the neighbors are ready, the bonds to them are separate tasks")
+        ;
+    desc_commandline.add_options()
+        ( "priorities",
+          "schedule the coordinate updates and the bonds of --split_rhs before the other work")
+        ;
+    desc_commandline.add_options()
+        ( "executor",
+          boost::program_options::value<std::string>()->default_value("pool"),
+          "executor of the tasks: pool, sequential or fork_join (pool)")
+        ;
+    desc_commandline.add_options()
+        ( "coarsening",
+          boost::program_options::value<std::size_t>()->default_value(1),
+          "number of consecutive blocks updated in one algebra task, only with fork_join or --priorities, where the updates are tasks of their own (1)")
+        ;
 
     // Initialize and run HPX
     return hpx::init(desc_commandline, argc, argv);
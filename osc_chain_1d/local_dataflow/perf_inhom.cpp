@@ -22,8 +22,11 @@
 #include "local_dataflow_shared_operations.hpp"
 #include "initialize.hpp"
 #include "system.hpp"
+#include "balance.hpp"
 
-using hpx::lcos::future;
+#include "../../common/aligned_allocator.hpp"
+
+using hpx::lcos::shared_future;
 using hpx::find_here;
 using hpx::lcos::wait;
 using hpx::make_ready_future;
@@ -34,9 +37,9 @@ using hpx::util::unwrapped;
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 using boost::numeric::odeint::integrate_n_steps;
 
-typedef std::vector< double > dvec;
+typedef aligned_dvec dvec;
 typedef std::shared_ptr< dvec > shared_vec;
-typedef std::vector< future< shared_vec > > state_type;
+typedef std::vector< shared_future< shared_vec > > state_type;
 
 typedef symplectic_rkn_sb3a_mclachlan< state_type ,
                                        state_type ,
@@ -55,6 +58,8 @@ int hpx_main(boost::program_options::variables_map& vm)
     const std::size_t G = vm["G"].as<std::size_t>();
     const std::size_t steps = vm["steps"].as<std::size_t>();
     const double dt = vm["dt"].as<double>();
+    const std::size_t rebalance = vm["rebalance"].as<std::size_t>();
+    const bool partition = vm.count( "partition" ) > 0;
     const std::size_t M = N/G;
 
     double avrg_time = 0.0;
@@ -88,16 +93,24 @@ int hpx_main(boost::program_options::variables_map& vm)
             current_index += G_;
         }
 
+        // every site of the chain costs the same
+        if( partition )
+            partition_blocks( q , p , std::vector< double >( current_index , 1.0 ) , M );
+
         wait( q );
         wait( p );
 
-        std::clog << "Initialization complete, energy: " << energy( q , p ) << std::endl;
+        std::clog << "Initialization complete, energy: " << energy( q , p ).get() << std::endl;
 
         hpx::util::high_resolution_timer timer;
 
-        integrate_n_steps( stepper_type() , osc_chain , 
-                           std::make_pair( boost::ref(q) , boost::ref(p) ) ,
-                           0.0 , dt , steps );
+        if( rebalance > 0 )
+            integrate_balanced< stepper_type >( q , p , kappa_type() , lambda_type() ,
+                                                0.0 , dt , steps , rebalance );
+        else
+            integrate_n_steps( stepper_type() , osc_chain<>() , 
+                               std::make_pair( boost::ref(q) , boost::ref(p) ) ,
+                               0.0 , dt , steps );
 
         //hpx::cout << "dataflow generation ready\n" << hpx::flush;
 
@@ -106,7 +119,7 @@ int hpx_main(boost::program_options::variables_map& vm)
 
         double run_time = timer.elapsed();
 
-        std::clog << "Integration complete, energy: " << energy( q , p ) << std::endl;
+        std::clog << "Integration complete, energy: " << energy( q , p ).get() << std::endl;
 
         if( n > 1 )
         {
@@ -149,6 +162,15 @@ int main( int argc , char* argv[] )
           boost::program_options::value<double>()->default_value(0.01),
           "step size (0.01)")
         ;
+    desc_commandline.add_options()
+        ( "rebalance",
+          boost::program_options::value<std::size_t>()->default_value(0),
+          "re-partition the blocks by measured cost every n steps, 0: never (0)")
+        ;
+    desc_commandline.add_options()
+        ( "partition",
+          "partition the initial blocks by cost instead of alternating G/2 and 3G/2")
+        ;
 
     // Initialize and run HPX
     return hpx::init(desc_commandline, argc, argv);
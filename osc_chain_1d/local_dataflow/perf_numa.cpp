@@ -0,0 +1,135 @@
+// Copyright 2013 Mario Mulansky
+//
+// memory bandwidth of the blocks of a futurized state with and without numa
+// placement. the triad a = b + s*c runs as one task per block, the same access
+// pattern as the coordinate and momentum updates of the stepper. reports the
+// pages of the blocks that lie on their home domain and the bandwidth.
+
+#include <iostream>
+#include <vector>
+#include <memory>
+
+#define HPX_LIMIT 6
+
+#include <hpx/hpx.hpp>
+#include <hpx/hpx_init.hpp>
+#include <hpx/lcos/local/dataflow.hpp>
+#include <hpx/util/unwrapped.hpp>
+#include <hpx/include/iostreams.hpp>
+
+#include "initialize.hpp"
+
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/numa_placement.hpp"
+
+using hpx::lcos::shared_future;
+using hpx::lcos::wait_all;
+using hpx::make_ready_future;
+using hpx::lcos::local::dataflow;
+using hpx::util::unwrapped;
+
+typedef aligned_dvec dvec;
+typedef std::shared_ptr< dvec > shared_vec;
+typedef std::vector< shared_future< shared_vec > > state_type;
+
+struct triad
+{
+    const double m_s;
+
+    triad( const double s )
+        : m_s( s )
+    { }
+
+    shared_vec operator()( shared_vec a , shared_vec b , shared_vec c ) const
+    {
+        for( size_t i=0 ; i<a->size() ; ++i )
+            (*a)[i] = (*b)[i] + m_s*(*c)[i];
+        return a;
+    }
+};
+
+size_t pages_at_home( const state_type &x , size_t &pages )
+{
+    const numa_placement &numa = numa_placement::instance();
+    size_t n = 0;
+    for( size_t i=0 ; i<x.size() ; ++i )
+        n += numa.pages_on( *x[i].get() , numa.home( i , x.size() ) , pages );
+    return n;
+}
+
+int hpx_main(boost::program_options::variables_map& vm)
+{
+    const std::size_t N = vm["N"].as<std::size_t>();
+    const std::size_t G = vm["G"].as<std::size_t>();
+    const std::size_t sweeps = vm["sweeps"].as<std::size_t>();
+    const std::size_t M = N/G;
+
+    numa_placement::instance().enable( vm.count( "numa" ) > 0 );
+
+    dvec init( N , 1.0 );
+
+    state_type a( M ) , b( M ) , c( M );
+    for( size_t i=0 ; i<M ; ++i )
+    {
+        a[i] = dataflow( unwrapped(initialize_zero( G , i , M )) , make_ready_future( shared_vec() ) );
+        b[i] = dataflow( unwrapped(initialize_copy( init , i*G , G )) , make_ready_future( shared_vec() ) );
+        c[i] = dataflow( unwrapped(initialize_copy( init , i*G , G )) , make_ready_future( shared_vec() ) );
+    }
+    wait_all( a );
+    wait_all( b );
+    wait_all( c );
+
+    size_t pages = 0;
+    const size_t home = pages_at_home( a , pages ) + pages_at_home( b , pages ) + pages_at_home( c , pages );
+    std::clog << "numa domains: " << numa_placement::instance().domains()
+              << ", pages on home domain: " << home << " of " << pages << std::endl;
+
+    double min_time = 1000000.0;
+    for( size_t n=0 ; n<12 ; ++n )
+    {
+        hpx::util::high_resolution_timer timer;
+        for( size_t s=0 ; s<sweeps ; ++s )
+            for( size_t i=0 ; i<M ; ++i )
+                a[i] = dataflow( hpx::launch::async , unwrapped( triad( 0.5 ) ) , a[i] , b[i] , c[i] );
+        wait_all( a );
+        const double run_time = timer.elapsed();
+        if( n > 1 )
+            min_time = std::min( run_time , min_time );
+    }
+
+    // three doubles are moved per element and sweep
+    const double bytes = 3.0*sizeof( double )*N*sweeps;
+    hpx::cout << (boost::format("%d\t%d\t%f\t%f\n") % N % G % min_time % (bytes/min_time*1E-9)) << hpx::flush;
+
+    return hpx::finalize();
+}
+
+
+int main( int argc , char* argv[] )
+{
+    boost::program_options::options_description
+       desc_commandline("Usage: " HPX_APPLICATION_STRING " [options]");
+
+    desc_commandline.add_options()
+        ( "N",
+          boost::program_options::value<std::size_t>()->default_value(1<<24),
+          "Dimension (2^24)")
+        ;
+    desc_commandline.add_options()
+        ( "G",
+          boost::program_options::value<std::size_t>()->default_value(1<<16),
+          "Block size (2^16)")
+        ;
+    desc_commandline.add_options()
+        ( "sweeps",
+          boost::program_options::value<std::size_t>()->default_value(10),
+          "triad sweeps per run (10)")
+        ;
+    desc_commandline.add_options()
+        ( "numa",
+          "place the blocks on the numa domains of their position in the state")
+        ;
+
+    // Initialize and run HPX
+    return hpx::init(desc_commandline, argc, argv);
+}
@@ -23,6 +23,8 @@
 #include "initialize.hpp"
 #include "system.hpp"
 
+#include "../../common/aligned_allocator.hpp"
+
 using hpx::lcos::future;
 using hpx::find_here;
 using hpx::lcos::wait;
@@ -34,7 +36,7 @@ using hpx::util::unwrapped;
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 using boost::numeric::odeint::integrate_n_steps;
 
-typedef std::vector< double > dvec;
+typedef aligned_dvec dvec;
 typedef std::shared_ptr< dvec > shared_vec;
 typedef std::vector< future< shared_vec > > state_type;
 
@@ -89,7 +91,7 @@ int hpx_main(boost::program_options::variables_map& vm)
 
         hpx::util::high_resolution_timer timer;
 
-        integrate_n_steps( stepper_type() , osc_chain , 
+        integrate_n_steps( stepper_type() , osc_chain<>() , 
                            std::make_pair( boost::ref(q) , boost::ref(p) ) ,
                            0.0 , dt , steps );
 
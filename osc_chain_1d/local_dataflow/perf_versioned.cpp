@@ -0,0 +1,172 @@
+// Copyright 2013 Mario Mulansky
+//
+// performance of the chain with multi-versioned coordinate blocks, see
+// versioned_state.hpp
+
+#include <iostream>
+#include <vector>
+#include <memory>
+
+#define HPX_LIMIT 6
+
+#include <hpx/hpx.hpp>
+#include <hpx/hpx_init.hpp>
+#include <hpx/lcos/local/dataflow.hpp>
+#include <hpx/lcos/async.hpp>
+#include <hpx/util/unwrapped.hpp>
+#include <hpx/include/iostreams.hpp>
+
+#include <boost/numeric/odeint.hpp>
+
+#include "local_dataflow_shared_resize.hpp"
+#include "local_dataflow_algebra.hpp"
+#include "versioned_state.hpp"
+#include "initialize.hpp"
+#include "system.hpp"
+
+#include "../../common/aligned_allocator.hpp"
+
+using hpx::lcos::shared_future;
+using hpx::lcos::wait_all;
+using hpx::make_ready_future;
+using hpx::lcos::local::dataflow;
+using hpx::util::unwrapped;
+
+using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
+using boost::numeric::odeint::integrate_n_steps;
+
+typedef aligned_dvec dvec;
+typedef std::shared_ptr< dvec > shared_vec;
+typedef std::vector< shared_future< shared_vec > > state_type;
+
+template< size_t K >
+struct perf_run
+{
+    typedef symplectic_rkn_sb3a_mclachlan< versioned_state< K > ,
+                                           state_type ,
+                                           double ,
+                                           versioned_state< K > ,
+                                           state_type ,
+                                           double ,
+                                           local_dataflow_algebra ,
+                                           versioned_operations > stepper_type;
+
+    double avrg_time;
+    double min_time;
+
+    perf_run( const std::size_t N , const std::size_t G ,
+              const std::size_t steps , const double dt )
+        : avrg_time( 0.0 ) , min_time( 1000000.0 )
+    {
+        const std::size_t M = N/G;
+
+        for( size_t n=0 ; n<12 ; ++n )
+        {
+            dvec p_init( N );
+
+            std::uniform_real_distribution<double> distribution( -1.0 , 1.0 );
+            std::mt19937 engine( 0 ); // Mersenne twister MT19937
+            auto generator = std::bind(distribution, engine);
+
+            std::generate( p_init.begin() ,
+                           p_init.end() ,
+                           std::ref(generator) );
+
+            versioned_state< K > q( M );
+            state_type p( M );
+
+            for( size_t i=0 ; i<M ; ++i )
+            {
+                q[i] = make_ready_future( versioned_block< K >( ) );
+                q[i] = dataflow( unwrapped(initialize_versioned_zero< K >( G , i , M )) , q[i] );
+                p[i] = make_ready_future( std::make_shared<dvec>( ) );
+                p[i] = dataflow( unwrapped(initialize_copy( p_init , i*G , G )) , p[i] );
+            }
+
+            wait_all( q );
+            wait_all( p );
+
+            hpx::util::high_resolution_timer timer;
+
+            integrate_n_steps( stepper_type() , osc_chain<>() ,
+                               std::make_pair( boost::ref(q) , boost::ref(p) ) ,
+                               0.0 , dt , steps );
+
+            wait_all( q );
+            wait_all( p );
+
+            double run_time = timer.elapsed();
+
+            if( n > 1 )
+            {
+                avrg_time += run_time;
+                min_time = std::min( run_time , min_time );
+            }
+
+            std::clog << G << ", run: " << n << " run time: " << run_time << std::endl;
+        }
+    }
+};
+
+int hpx_main(boost::program_options::variables_map& vm)
+{
+    const std::size_t N = vm["N"].as<std::size_t>();
+    const std::size_t G = vm["G"].as<std::size_t>();
+    const std::size_t steps = vm["steps"].as<std::size_t>();
+    const double dt = vm["dt"].as<double>();
+    const std::size_t versions = vm["versions"].as<std::size_t>();
+
+    double min_time , avrg_time;
+    if( versions == 3 )
+    {
+        perf_run< 3 > run( N , G , steps , dt );
+        min_time = run.min_time;
+        avrg_time = run.avrg_time;
+    }
+    else
+    {
+        perf_run< 2 > run( N , G , steps , dt );
+        min_time = run.min_time;
+        avrg_time = run.avrg_time;
+    }
+
+    hpx::cout << (boost::format("%d\t%f\t%f\n") % G % min_time % (avrg_time/10)) << hpx::flush;
+
+    return hpx::finalize();
+}
+
+
+int main( int argc , char* argv[] )
+{
+    boost::program_options::options_description
+       desc_commandline("Usage: " HPX_APPLICATION_STRING " [options]");
+
+    desc_commandline.add_options()
+        ( "N",
+          boost::program_options::value<std::size_t>()->default_value(1024),
+          "Dimension (1024)")
+        ;
+    desc_commandline.add_options()
+        ( "G",
+          boost::program_options::value<std::size_t>()->default_value(128),
+          "Block size (128)")
+        ;
+    desc_commandline.add_options()
+        ( "steps",
+          boost::program_options::value<std::size_t>()->default_value(100),
+          "time steps (100)")
+        ;
+    desc_commandline.add_options()
+        ( "dt",
+          boost::program_options::value<double>()->default_value(0.01),
+          "step size (0.01)")
+        ;
+    desc_commandline.add_options()
+        ( "versions",
+          boost::program_options::value<std::size_t>()->default_value(2),
+          "number of versions per coordinate block, 2 or 3 (2)")
+        ;
+
+    // Initialize and run HPX
+    return hpx::init(desc_commandline, argc, argv);
+}
@@ -0,0 +1,411 @@
+// Copyright 2013 Mario Mulansky
+// co-located storage of the chain: q, p and the stepper's dpdt of one block
+// share one allocation and one future. the stepper sees three views of the
+// same phase_state (coordinate, momentum and derivative part), so a stage
+// depends on a single future per block instead of one per state, and the
+// scale_sum2 updates read and write neighboring memory.
+// the blocks are templated on the storage type: with float storage the data
+// is read as float, all arithmetic is done in double and the results are
+// rounded when stored, see drift_phase.cpp for the accuracy.
+#ifndef PHASE_STATE_HPP
+#define PHASE_STATE_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <boost/numeric/odeint/util/state_wrapper.hpp>
+#include <boost/numeric/odeint/util/is_resizeable.hpp>
+#include <boost/numeric/odeint/util/resize.hpp>
+#include <boost/numeric/odeint/util/same_size.hpp>
+
+#include <hpx/lcos/future.hpp>
+#include <hpx/lcos/local/dataflow.hpp>
+#include <hpx/util/unwrapped.hpp>
+
+#include "../../common/block_pool.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/numa_placement.hpp"
+#include "../../common/quiescence.hpp"
+#include "../../common/chain_kernels.hpp"
+#include "../../common/async_reduce.hpp"
+#include "../../common/task_executor.hpp"
+
+#include "system.hpp"
+
+using hpx::lcos::local::dataflow;
+using hpx::lcos::shared_future;
+using hpx::make_ready_future;
+using hpx::util::unwrapped;
+
+typedef aligned_dvec dvec;
+
+enum phase_part { coor_part = 0 , momentum_part = 1 , deriv_part = 2 };
+
+// one block of the chain stored as [ q | p | dpdt ], each part padded to
+// whole cache lines
+template< class T >
+class basic_phase_block
+{
+public:
+
+    typedef T value_type;
+    typedef std::vector< T , aligned_allocator< T > > storage_type;
+
+    basic_phase_block()
+        : m_size( 0 ) , m_stride( 0 )
+    { }
+
+    // the contents are undefined after a change of the size
+    void resize( const size_t n )
+    {
+        if( n == m_size )
+            return;
+        m_size = n;
+        const size_t line = cache_line_size / sizeof( T );
+        m_stride = ( ( n + line - 1 ) / line ) * line;
+        m_data.assign( 3*m_stride , T( 0 ) );
+    }
+
+    size_t size() const { return m_size; }
+
+    T* part( const phase_part k ) { return m_data.data() + k*m_stride; }
+    const T* part( const phase_part k ) const { return m_data.data() + k*m_stride; }
+
+    T* q() { return part( coor_part ); }
+    const T* q() const { return part( coor_part ); }
+    T* p() { return part( momentum_part ); }
+    const T* p() const { return part( momentum_part ); }
+
+    // the full storage, used for the numa placement
+    storage_type& storage() { return m_data; }
+
+private:
+    size_t m_size;
+    size_t m_stride;
+    storage_type m_data;
+};
+
+// one part of all blocks of a state, used as coordinate, momentum and
+// derivative type of the stepper. the views share the futures of the state.
+template< class T >
+struct basic_phase_view
+{
+    typedef basic_phase_block< T > block_type;
+    typedef std::shared_ptr< block_type > shared_block;
+    typedef std::vector< shared_future< shared_block > > state_type;
+
+    state_type *m_state;
+    phase_part m_part;
+
+    basic_phase_view( state_type *state = 0 , const phase_part part = coor_part )
+        : m_state( state ) , m_part( part )
+    { }
+
+    size_t size() const { return ( m_state != 0 ) ? m_state->size() : 0; }
+};
+
+typedef basic_phase_block< double > phase_block;
+typedef basic_phase_view< double > phase_view;
+typedef phase_view::shared_block shared_phase;
+typedef phase_view::state_type phase_state;
+
+// single precision storage
+typedef basic_phase_block< float > float_phase_block;
+typedef basic_phase_view< float > float_phase_view;
+typedef float_phase_view::shared_block shared_float_phase;
+typedef float_phase_view::state_type float_phase_state;
+
+
+// initial block: q = 0 and p copied from data, dpdt is set by the system
+template< class T >
+struct basic_initialize_phase
+{
+    const dvec &m_data;
+    const size_t m_index;
+    const size_t m_len;
+
+    typedef std::shared_ptr< basic_phase_block< T > > shared_block;
+
+    basic_initialize_phase( const dvec &data , const size_t index , const size_t len )
+        : m_data( data ) , m_index( index ) , m_len( len )
+    { }
+
+    shared_block operator()( shared_block ) const
+    {
+        const numa_placement &numa = numa_placement::instance();
+        const size_t d = numa.domain( m_index , m_data.size() );
+        shared_block b = block_pool< basic_phase_block< T > >::instance().acquire( d );
+        b->resize( m_len );
+        std::fill( b->q() , b->q() + m_len , T( 0 ) );
+        std::copy( &(m_data[m_index]) , &(m_data[m_index+m_len]) , b->p() );
+        numa.place_on( b->storage() , d );
+        return b;
+    }
+};
+
+typedef basic_initialize_phase< double > initialize_phase;
+typedef basic_initialize_phase< float > initialize_float_phase;
+
+
+// applies an operation to the parts of the blocks. all three arguments are
+// usually parts of the same block, then only one future is involved.
+template< class Op >
+struct phase_op
+{
+    const Op m_op;
+    const phase_part m_k1 , m_k2 , m_k3;
+
+    phase_op( const Op op , const phase_part k1 , const phase_part k2 , const phase_part k3 )
+        : m_op( op ) , m_k1( k1 ) , m_k2( k2 ) , m_k3( k3 )
+    { }
+
+    template< class B >
+    B operator()( B b ) const
+    {
+        m_op( b->part( m_k1 ) , b->part( m_k2 ) , b->part( m_k3 ) , b->size() );
+        return b;
+    }
+
+    template< class B >
+    B operator()( B b1 , B b2 , B b3 ) const
+    {
+        m_op( b1->part( m_k1 ) , b2->part( m_k2 ) , b3->part( m_k3 ) , b1->size() );
+        return b1;
+    }
+};
+
+struct phase_algebra
+{
+    template< typename T , typename Op >
+    void for_each3( basic_phase_view< T > &s1 , const basic_phase_view< T > &s2 , 
+                    const basic_phase_view< T > &s3 , Op op )
+    {
+        typename basic_phase_view< T >::state_type &x1 = *s1.m_state;
+        const phase_op< Op > block_op( op , s1.m_part , s2.m_part , s3.m_part );
+        const size_t N = x1.size();
+        const task_executor &executor = task_executor::instance();
+        if( s2.m_state == s1.m_state && s3.m_state == s1.m_state )
+            for( size_t i=0 ; i<N ; ++i )
+                x1[i] = executor( update_task , unwrapped( block_op ) , x1[i] );
+        else
+            for( size_t i=0 ; i<N ; ++i )
+                x1[i] = executor( update_task , unwrapped( block_op ) ,
+                                  x1[i] , (*s2.m_state)[i] , (*s3.m_state)[i] );
+        executor.stage( x1 );
+    }
+};
+
+struct phase_operations
+{
+    template< typename Fac1 , typename Fac2=Fac1 >
+    struct scale_sum2
+    {
+        const Fac1 m_alpha1;
+        const Fac2 m_alpha2;
+
+        scale_sum2( Fac1 alpha1 , Fac2 alpha2 )
+            : m_alpha1( alpha1 ) , m_alpha2( alpha2 )
+        { }
+
+        // computed in double for float storage as well
+        template< class T >
+        void operator()( T *x1 , const T *x2 , const T *x3 , const size_t n ) const
+        {
+            // in-place update with a zero increment, nothing to do
+            if( m_alpha1 == 1 && x1 == x2 && all_zero( x3 , n ) )
+                return;
+            for( size_t i=0 ; i<n ; ++i )
+                x1[i] = T( m_alpha1*double( x2[i] ) + m_alpha2*double( x3[i] ) );
+        }
+    };
+};
+
+
+// the coupling values of the neighbors, read from their coordinate parts.
+// each is copied as soon as its own neighbor is ready, the next coordinate
+// update of a neighbor does not wait for the blocks reading it
+struct phase_left_ghost
+{
+    template< class B >
+    double operator()( B q_l ) const { return q_l->q()[q_l->size()-1]; }
+};
+
+struct phase_right_ghost
+{
+    template< class B >
+    double operator()( B q_r ) const { return q_r->q()[0]; }
+};
+
+// writes the derivative part of one block
+template< class Kappa , class Lambda >
+struct phase_block_rhs
+{
+    const Kappa m_kappa;
+    const Lambda m_lambda;
+
+    phase_block_rhs( const Kappa kappa , const Lambda lambda )
+        : m_kappa( kappa ) , m_lambda( lambda )
+    { }
+
+    template< class B >
+    B operator()( B b , const double left , const double right ) const
+    {
+        typedef typename B::element_type::value_type value_type;
+        const size_t n = b->size();
+        value_type *dpdt = b->part( deriv_part );
+        // quiescent block, the force vanishes
+        if( left == 0.0 && right == 0.0 && all_zero( b->q() , n ) )
+            std::fill( dpdt , dpdt + n , value_type( 0 ) );
+        else
+            chain_kernels::block_rhs( b->q() , dpdt , n , left , right ,
+                                      m_kappa.minus_one() , m_lambda.minus_one() );
+        return b;
+    }
+};
+
+// the fixed ends q = 0 as a neighbor block
+template< class T >
+shared_future< std::shared_ptr< basic_phase_block< T > > > phase_wall()
+{
+    std::shared_ptr< basic_phase_block< T > > b = std::make_shared< basic_phase_block< T > >();
+    b->resize( 1 );
+    return make_ready_future( b );
+}
+
+template< class Kappa = kappa_type , class Lambda = lambda_type , class T = double >
+struct osc_chain_phase
+{
+    typedef basic_phase_view< T > view_type;
+
+    const phase_block_rhs< Kappa , Lambda > m_block;
+    const shared_future< typename view_type::shared_block > m_wall;
+
+    osc_chain_phase( const Kappa kappa = Kappa() , const Lambda lambda = Lambda() )
+        : m_block( kappa , lambda ) , m_wall( phase_wall< T >() )
+    { }
+
+    // q and dpdt are views of the same state
+    void operator()( view_type &q , view_type & /* dpdt */ ) const
+    {
+        typename view_type::state_type &x = *q.m_state;
+        const size_t N = x.size();
+        const task_executor &executor = task_executor::instance();
+        // all halos are taken from the blocks before any of them is replaced
+        // by its rhs task, otherwise the blocks would wait for each other
+        std::vector< shared_future< double > > g_l( N ) , g_r( N );
+        for( size_t i=0 ; i<N ; ++i )
+        {
+            g_l[i] = executor.sync( unwrapped( phase_left_ghost() ) ,
+                                    ( i > 0 ) ? x[i-1] : m_wall );
+            g_r[i] = executor.sync( unwrapped( phase_right_ghost() ) ,
+                                    ( i < N-1 ) ? x[i+1] : m_wall );
+        }
+        for( size_t i=0 ; i<N ; ++i )
+            x[i] = executor( bulk_task , unwrapped( m_block ) , x[i] , g_l[i] , g_r[i] );
+        executor.stage( x );
+    }
+};
+
+
+// energy of one block including the bond to its right neighbor, summed in
+// double. the bonds to the walls at both ends of the chain count half.
+template< class Kappa , class Lambda >
+struct phase_block_energy
+{
+    const Kappa m_kappa;
+    const Lambda m_lambda;
+    const bool m_first;
+    const bool m_last;
+
+    phase_block_energy( const Kappa kappa , const Lambda lambda ,
+                        const bool first , const bool last )
+        : m_kappa( kappa ) , m_lambda( lambda ) , m_first( first ) , m_last( last )
+    { }
+
+    template< class B >
+    double operator()( B b , B b_r ) const
+    {
+        const double K = m_kappa.value();
+        const double L = m_lambda.value();
+        const size_t N = b->size();
+        double energy = m_first ? 0.5*m_lambda.pow( b->q()[0] ) / L : 0.0;
+        for( size_t i=0 ; i<N ; ++i )
+        {
+            const double q = b->q()[i];
+            const double p = b->p()[i];
+            // the right neighbor, the wall for the last block
+            const double q_r = ( i < N-1 ) ? b->q()[i+1] : ( m_last ? 0.0 : b_r->q()[0] );
+            energy += 0.5*p*p + m_kappa.pow( q ) / K
+                + ( ( m_last && i == N-1 ) ? 0.5 : 1.0 )*m_lambda.pow( q - q_r ) / L;
+        }
+        return energy;
+    }
+};
+
+// passes the block on after the energy tasks reading it are finished
+struct phase_energy_fence
+{
+    template< class B >
+    B operator()( B b , const double , const double ) const
+    {
+        return b;
+    }
+};
+
+// asynchronous energy of a co-located state, one task per block summed in a
+// tree. the blocks are fenced so later in-place updates wait for the tasks.
+template< class T , class Kappa , class Lambda >
+shared_future< double > energy( std::vector< shared_future< std::shared_ptr< basic_phase_block< T > > > > &x ,
+                                const Kappa kappa , const Lambda lambda ,
+                                const task_executor &executor = task_executor::instance() )
+{
+    const size_t N = x.size();
+    std::vector< shared_future< double > > e( N );
+    for( size_t i=0 ; i<N ; ++i )
+        e[i] = executor( bulk_task ,
+                         unwrapped( phase_block_energy< Kappa , Lambda >( kappa , lambda , i==0 , i==N-1 ) ) ,
+                         x[i] , ( i < N-1 ) ? x[i+1] : x[i] );
+    const shared_future< double > total = tree_sum( e );
+    for( size_t i=0 ; i<N ; ++i )
+        x[i] = executor.sync( unwrapped( phase_energy_fence() ) ,
+                              x[i] , e[i] , ( i > 0 ) ? e[i-1] : e[i] );
+    return total;
+}
+
+
+namespace boost {
+namespace numeric {
+namespace odeint {
+
+template< class T >
+struct is_resizeable< basic_phase_view< T > >
+{
+    typedef boost::true_type type;
+    const static bool value = type::value;
+};
+
+template< class T >
+struct same_size_impl< basic_phase_view< T > , basic_phase_view< T > >
+{
+    static bool same_size( const basic_phase_view< T > &x1 , const basic_phase_view< T > &x2 )
+    {
+        return x1.m_state == x2.m_state;
+    }
+};
+
+// the derivative of the stepper is the third part of the same blocks,
+// nothing is allocated
+template< class T >
+struct resize_impl< basic_phase_view< T > , basic_phase_view< T > >
+{
+    static void resize( basic_phase_view< T > &x1 , const basic_phase_view< T > &x2 )
+    {
+        x1.m_state = x2.m_state;
+        x1.m_part = deriv_part;
+    }
+};
+
+} } }
+
+#endif
@@ -0,0 +1,84 @@
+// Copyright 2013 Mario Mulansky
+// changing the block size of a futurized state, used for auto-tuning G
+#ifndef REBLOCK_HPP
+#define REBLOCK_HPP
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+#include <hpx/lcos/future.hpp>
+
+#include "../../common/block_pool.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/numa_placement.hpp"
+
+using hpx::lcos::shared_future;
+using hpx::lcos::wait_all;
+using hpx::make_ready_future;
+
+typedef aligned_dvec dvec;
+typedef std::shared_ptr< dvec > shared_vec;
+typedef std::vector< shared_future< shared_vec > > state_type;
+
+// redistributes x into blocks of the given sizes, waits for x to be ready.
+// the sizes have to add up to the total size. the blocks are of any type,
+// double or float.
+template< class Block >
+void reblock( std::vector< shared_future< std::shared_ptr< Block > > > &x , const std::vector< size_t > &sizes )
+{
+    wait_all( x );
+    Block data;
+    for( size_t i=0 ; i<x.size() ; ++i )
+        data.insert( data.end() , x[i].get()->begin() , x[i].get()->end() );
+    std::vector< shared_future< std::shared_ptr< Block > > > y( sizes.size() );
+    size_t start = 0;
+    for( size_t i=0 ; i<sizes.size() ; ++i )
+    {
+        const size_t d = numa_placement::instance().domain( start , data.size() );
+        std::shared_ptr< Block > b = block_pool< Block >::instance().acquire( d );
+        b->assign( data.begin()+start , data.begin()+start+sizes[i] );
+        numa_placement::instance().place_on( *b , d );
+        y[i] = make_ready_future( b );
+        start += sizes[i];
+    }
+    x.swap( y );
+}
+
+// blocks of G elements, the total size has to be a multiple of G
+template< class Block >
+void reblock( std::vector< shared_future< std::shared_ptr< Block > > > &x , const size_t G )
+{
+    wait_all( x );
+    size_t N = 0;
+    for( size_t i=0 ; i<x.size() ; ++i )
+        N += x[i].get()->size();
+    reblock( x , std::vector< size_t >( N/G , G ) );
+}
+
+template< class State >
+std::vector< size_t > block_sizes( const State &x )
+{
+    std::vector< size_t > sizes( x.size() );
+    for( size_t i=0 ; i<x.size() ; ++i )
+        sizes[i] = x[i].get()->size();
+    return sizes;
+}
+
+// blocking of futurized states for reblock_trial
+struct reblocking
+{
+    template< class State >
+    void operator()( State &x , const size_t G ) const
+    {
+        reblock( x , G );
+    }
+
+    template< class State >
+    void wait( State &x ) const
+    {
+        wait_all( x );
+    }
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <vector>
 #include <memory>
 #include <cmath>
+#include <algorithm>
 
 #include <boost/math/special_functions/sign.hpp>
 #include <boost/thread/thread.hpp>
@@ -14,211 +15,503 @@
 #include <hpx/lcos/local/dataflow.hpp>
 #include <hpx/include/iostreams.hpp>
 #include <hpx/util/unwrapped.hpp>
+#include <hpx/util/high_resolution_timer.hpp>
+
+#include "../../common/checked_math.hpp"
+#include "../../common/exponent_policy.hpp"
+#include "../../common/chain_kernels.hpp"
+#include "../../common/quiescence.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/task_executor.hpp"
+#include "../../common/async_reduce.hpp"
+
+#include "task_graph.hpp"
+#include "versioned_state.hpp"
 
 using hpx::lcos::local::dataflow;
 using hpx::lcos::shared_future;
 using hpx::lcos::wait_all;
+using hpx::make_ready_future;
 using hpx::util::unwrapped;
 
-const double KAPPA = 3.5;
-const double LAMBDA = 4.5;
+// KAPPA = 3.5 , LAMBDA = 4.5
+typedef half_integer_exponent< 7 > kappa_type;
+typedef half_integer_exponent< 9 > lambda_type;
+
+const double KAPPA = kappa_type().value();
+const double LAMBDA = lambda_type().value();
+
+typedef aligned_dvec dvec;
+typedef std::shared_ptr< dvec > shared_vec;
+typedef std::vector< shared_future< shared_vec > > state_type;
 
-namespace checked_math {
-    inline double pow( double x , double y )
+// the chain with blocks stored in float, the forces are computed in double.
+// the block functors below take blocks of either type.
+typedef aligned_fvec fvec;
+typedef std::shared_ptr< fvec > shared_fvec;
+typedef std::vector< shared_future< shared_fvec > > float_state_type;
+
+// copies of the neighbor values q_{-1} and q_G of one block
+struct ghost_cells
+{
+    double left;
+    double right;
+};
+
+// the outer values of a block, the ghosts of its two neighbors. they are
+// copied synchronously once per block as soon as the block is ready: the
+// next in-place update of a block does not wait for the blocks reading it,
+// so each reader gets the copy of the version it needs
+struct block_edges
+{
+    double front;
+    double back;
+};
+
+struct edges_of
+{
+    template< class Block >
+    block_edges operator()( std::shared_ptr< Block > q ) const
     {
-        if( x==0.0 )
-            // 0**y = 0, don't care for y = 0 or NaN
-            return 0.0;
-        using std::pow;
-        using std::abs;
-        return pow( abs(x) , y );
+        const block_edges e = { q->front() , q->back() };
+        return e;
     }
-}
+};
 
-double signed_pow( double x , double k )
+// all blocks including the two at the ends of the chain, the fixed boundary
+// enters through the ghost cells
+template< class Kappa , class Lambda >
+struct system_block
 {
-    using boost::math::sign;
-    using std::abs;
-    return checked_math::pow( x , k ) * sign(x);
-}
+    const Kappa m_kappa;
+    const Lambda m_lambda;
 
-typedef std::vector< double > dvec;
-typedef std::shared_ptr< dvec > shared_vec;
-typedef std::vector< shared_future< shared_vec > > state_type;
+    system_block( const Kappa kappa , const Lambda lambda )
+        : m_kappa( kappa ) , m_lambda( lambda )
+    { }
 
-struct system_first_block
-{
-    shared_vec operator()( shared_vec q , const double q_r , shared_vec dpdt ) const
+    template< class Block >
+    std::shared_ptr< Block > operator()( std::shared_ptr< Block > q , const double left , const double right , 
+                                         std::shared_ptr< Block > dpdt ) const
     {
-        //hpx::cout << (boost::format("first block\n") ) << hpx::flush;
+        const ghost_cells g = { left , right };
+        return (*this)( *q , g , dpdt );
+    }
 
-        const size_t N = q->size();
+    // with the edges of the left and right neighbor
+    template< class Block >
+    std::shared_ptr< Block > operator()( std::shared_ptr< Block > q , const block_edges left , const block_edges right , 
+                                         std::shared_ptr< Block > dpdt ) const
+    {
+        return (*this)( q , left.back , right.front , dpdt );
+    }
 
-        double coupling_lr = -signed_pow( (*q)[0] , LAMBDA-1 );
-        for( size_t i=0 ; i<N-1 ; ++i )
+    template< class Block >
+    std::shared_ptr< Block > operator()( const Block &q , const ghost_cells g , std::shared_ptr< Block > dpdt ) const
+    {
+        // quiescent block, the force vanishes
+        if( g.left == 0.0 && g.right == 0.0 && all_zero( q ) )
         {
-            (*dpdt)[i] = -signed_pow( (*q)[i] , KAPPA-1 ) + coupling_lr;
-            coupling_lr = signed_pow( (*q)[i]-(*q)[i+1] , LAMBDA-1 );
-            (*dpdt)[i] -= coupling_lr;
+            std::fill( dpdt->begin() , dpdt->end() , 0 );
+            return dpdt;
         }
-        (*dpdt)[N-1] = -signed_pow( (*q)[N-1] , KAPPA-1 ) 
-            + coupling_lr - signed_pow( (*q)[N-1] - q_r , LAMBDA-1 );
-    
-        //hpx::cout << (boost::format("first block done\n") ) << hpx::flush;
+        chain_kernels::block_rhs( &q[0] , &(*dpdt)[0] , q.size() , 
+                                  g.left , g.right , m_kappa.minus_one() , m_lambda.minus_one() );
         return dpdt;
     }
 };
 
+// interior part of the split rhs of a block: needs only the block itself.
+// its own edge values serve as ghosts, so the bonds to the neighbors vanish
+// and are added later by bind_halo.
+template< class Kappa , class Lambda >
+struct interior_block
+{
+    const system_block< Kappa , Lambda > m_block;
+
+    interior_block( const system_block< Kappa , Lambda > &block )
+        : m_block( block )
+    { }
+
+    template< class Block >
+    std::shared_ptr< Block > operator()( std::shared_ptr< Block > q , std::shared_ptr< Block > dpdt ) const
+    {
+        const ghost_cells g = { q->front() , q->back() };
+        return m_block( *q , g , dpdt );
+    }
+};
+
+// forces of the bonds of a block to its left and right neighbor, the edge
+// tasks of the split rhs
+template< class Lambda >
+struct left_bond
+{
+    const Lambda m_lambda;
+
+    left_bond( const Lambda lambda ) : m_lambda( lambda ) { }
+
+    template< class Block >
+    double operator()( const block_edges left , std::shared_ptr< Block > q ) const
+    {
+        return m_lambda.minus_one().signed_pow( left.back - q->front() );
+    }
+};
 
-struct system_center_block
+template< class Lambda >
+struct right_bond
 {
+    const Lambda m_lambda;
 
-    shared_vec operator() ( shared_vec q , const double q_l , 
-                               const double q_r , shared_vec dpdt ) const
+    right_bond( const Lambda lambda ) : m_lambda( lambda ) { }
+
+    template< class Block >
+    double operator()( std::shared_ptr< Block > q , const block_edges right ) const
     {
-        //hpx::cout << (boost::format("center block\n") ) << hpx::flush;
- 
-        using checked_math::pow;
-        const size_t N = q->size();
-        double coupling_lr = -signed_pow( (*q)[0] - q_l , LAMBDA-1 );
-        for( size_t i=0 ; i<N-1 ; ++i )
-        {
-            (*dpdt)[i] = -signed_pow( (*q)[i] , KAPPA-1 ) + coupling_lr;
-            coupling_lr = signed_pow( (*q)[i]-(*q)[i+1] , LAMBDA-1 );
-            (*dpdt)[i] -= coupling_lr;
-        }
-        (*dpdt)[N-1] = -signed_pow( (*q)[N-1] , KAPPA-1 ) 
-            + coupling_lr - signed_pow( (*q)[N-1] - q_r , LAMBDA-1 );
+        return m_lambda.minus_one().signed_pow( q->back() - right.front );
+    }
+};
 
+// adds the bonds to the neighbors to the interior forces
+struct bind_halo
+{
+    template< class Block >
+    std::shared_ptr< Block > operator()( std::shared_ptr< Block > dpdt , const double left , const double right ) const
+    {
+        dpdt->front() += left;
+        dpdt->back() -= right;
         return dpdt;
     }
 };
 
+// rhs of a versioned block, the neighbor values are read in place from the
+// versions of the neighbor blocks
+template< class Kappa , class Lambda >
+struct versioned_system_block
+{
+    const system_block< Kappa , Lambda > m_block;
+
+    versioned_system_block( const system_block< Kappa , Lambda > &block )
+        : m_block( block )
+    { }
+
+    template< size_t K >
+    shared_vec operator()( const versioned_block< K > q_l , const versioned_block< K > q , 
+                           const versioned_block< K > q_r , shared_vec dpdt ) const
+    {
+        const ghost_cells g = { q_l->back() , q_r->front() };
+        return m_block( *q , g , dpdt );
+    }
+};
 
-struct system_last_block
+// fused momentum update p += c*dpdt(q) of one block, dpdt is not stored
+template< class Kappa , class Lambda >
+struct kick_block
 {
+    const Kappa m_kappa;
+    const Lambda m_lambda;
+    const double m_c;
+
+    kick_block( const Kappa kappa , const Lambda lambda , const double c )
+        : m_kappa( kappa ) , m_lambda( lambda ) , m_c( c )
+    { }
 
-    shared_vec operator()( shared_vec q , const double q_l , shared_vec dpdt ) const
+    template< class Block >
+    std::shared_ptr< Block > operator()( std::shared_ptr< Block > q , const block_edges l , const block_edges r , 
+                                         std::shared_ptr< Block > p ) const
     {
-        //hpx::cout << (boost::format("last block\n") ) << hpx::flush;
+        const double left = l.back;
+        const double right = r.front;
+        // quiescent block, the force vanishes and p stays
+        if( left == 0.0 && right == 0.0 && all_zero( *q ) )
+            return p;
+        chain_kernels::block_kick( &(*q)[0] , &(*p)[0] , q->size() , left , right ,
+                                   m_kappa.minus_one() , m_lambda.minus_one() , m_c );
+        return p;
+    }
+};
 
-        using checked_math::pow;
-        const size_t N = q->size();
+// adds the run time of the block to *m_time, used for load balancing
+template< class Kappa , class Lambda >
+struct timed_block
+{
+    const system_block< Kappa , Lambda > m_block;
+    double *m_time;
 
-        double coupling_lr = -signed_pow( (*q)[0] - q_l , LAMBDA-1 );
-        for( size_t i=0 ; i<N-1 ; ++i )
-        {
-            (*dpdt)[i] = -signed_pow( (*q)[i] , KAPPA-1 ) + coupling_lr;
-            coupling_lr = signed_pow( (*q)[i]-(*q)[i+1] , LAMBDA-1 );
-            (*dpdt)[i] -= coupling_lr;
-        }
-        (*dpdt)[N-1] = -signed_pow( (*q)[N-1] , KAPPA-1 ) 
-            + coupling_lr - signed_pow( (*q)[N-1] , LAMBDA-1 );
+    timed_block( const system_block< Kappa , Lambda > &block , double *time )
+        : m_block( block ) , m_time( time )
+    { }
 
+    template< class Block >
+    std::shared_ptr< Block > operator()( std::shared_ptr< Block > q , const block_edges left , const block_edges right , 
+                                         std::shared_ptr< Block > dpdt ) const
+    {
+        hpx::util::high_resolution_timer timer;
+        m_block( q , left , right , dpdt );
+        *m_time += timer.elapsed();
         return dpdt;
     }
 };
 
-void osc_chain( state_type &q , state_type &dpdt )
+// the fixed ends q = 0 as a neighbor block
+inline shared_future< shared_vec > chain_wall()
 {
-    // works on shared data, but coupling data is provided as copy
-    const size_t N = q.size();
+    return make_ready_future( std::make_shared< dvec >( 1 , 0.0 ) );
+}
 
-    //hpx::cout << boost::format("system call size: %d , %d ...\n") % (q.size()) % (dpdt.size()) << hpx::flush;
-
-    //state_type dpdt_(N);
-    // first row
-    dpdt[0] = dataflow( hpx::launch::async , unwrapped(system_first_block()) , q[0] , 
-                        dataflow( hpx::launch::sync , unwrapped([](shared_vec v) 
-        { return (*v)[0]; }) , q[1] ) , 
-                        dpdt[0] );
-    // middle rows
-    for( size_t i=1 ; i<N-1 ; i++ )
-    {
-        dpdt[i] = dataflow( hpx::launch::async , unwrapped(system_center_block()) , q[i] , 
-                            dataflow( hpx::launch::sync , unwrapped([](shared_vec v) 
-            { return (*v)[v->size()-1]; }) ,
-                                      q[i-1] ) , 
-                            dataflow( hpx::launch::sync , unwrapped([](shared_vec v) 
-            { return (*v)[0]; }) , q[i+1] ) ,
-                            dpdt[i] );
-    }
-    dpdt[N-1] = dataflow( hpx::launch::async , unwrapped(system_last_block()) , q[N-1] , 
-                          dataflow( hpx::launch::sync , unwrapped([](shared_vec v) 
-        { return (*v)[v->size()-1]; }), 
-                                    q[N-2] ) , 
-                          dpdt[N-1] );
-
-    /*
-    // synchronization to make sure q doesn't get changed while dpdt isn't ready
-    for( size_t i=1 ; i<N-1 ; i++ )
-    {
-        q[i] = dataflow( hpx::launch::async , 
-                         unwrap([]( shared_vec x , shared_vec sync){ return x; } ) ,
-                         q[i] , 
-                         dpdt[i] );
-    }
-    */
+// edges of the blocks of q, one sync copy per block. e[i] are the edges of
+// q[i-1], the ends of the chain are the fixed walls q = 0
+template< class State >
+std::vector< shared_future< block_edges > > chain_edges( const State &q , const task_executor &executor )
+{
+    const size_t N = q.size();
+    const block_edges wall = { 0.0 , 0.0 };
+    std::vector< shared_future< block_edges > > e( N+2 );
+    e[0] = make_ready_future( wall );
+    for( size_t i=0 ; i<N ; i++ )
+        e[i+1] = executor.sync( unwrapped( edges_of() ) , q[i] );
+    e[N+1] = make_ready_future( wall );
+    return e;
 }
 
-void osc_chain_gb( state_type &q , state_type &dpdt )
+// block_times, if given, accumulates the run time of each block. split
+// evaluates the interior of a block as soon as the block is ready and binds
+// the bonds to its neighbors later, at the cost of three more dataflows per
+// block. it pays off only for large blocks.
+template< class Kappa , class Lambda , class State >
+void osc_chain_rhs( const system_block< Kappa , Lambda > &block , 
+                    State &q , State &dpdt , const task_executor &executor ,
+                    std::vector< double > *block_times = 0 , const bool split = false )
 {
     // works on shared data, but coupling data is provided as copy
     const size_t N = q.size();
+    if( block_times != 0 )
+        block_times->resize( N , 0.0 );
+    const std::vector< shared_future< block_edges > > e = chain_edges( q , executor );
+    for( size_t i=0 ; i<N ; i++ )
+    {
+        // edges of the left and the right neighbor
+        const shared_future< block_edges > &e_l = e[i];
+        const shared_future< block_edges > &e_r = e[i+2];
+        if( block_times != 0 )
+        {
+            // whole blocks, the timing covers all work of a block
+            dpdt[i] = executor( bulk_task , 
+                                unwrapped( timed_block< Kappa , Lambda >( block , &(*block_times)[i] ) ) ,
+                                q[i] , e_l , e_r , dpdt[i] );
+        }
+        else if( split )
+        {
+            const typename State::value_type d = 
+                executor( bulk_task , unwrapped( interior_block< Kappa , Lambda >( block ) ) , q[i] , dpdt[i] );
+            dpdt[i] = executor.sync( unwrapped( bind_halo() ) , d , 
+                                executor( halo_task , unwrapped( left_bond< Lambda >( block.m_lambda ) ) , e_l , q[i] ) ,
+                                executor( halo_task , unwrapped( right_bond< Lambda >( block.m_lambda ) ) , q[i] , e_r ) );
+        }
+        else
+        {
+            dpdt[i] = executor( bulk_task , unwrapped( block ) , q[i] , e_l , e_r , dpdt[i] );
+        }
+    }
+    executor.stage( dpdt );
+}
 
-    // first row
-    dpdt[0] = dataflow( hpx::launch::async , unwrapped(system_first_block()) , q[0] , 
-                        dataflow( hpx::launch::sync , unwrapped([](shared_vec v) 
-        { return (*v)[0]; }) , q[1] ) , 
-                        dpdt[0] );
-    // middle rows
-    for( size_t i=1 ; i<N-1 ; i++ )
-    {
-        dpdt[i] = dataflow( hpx::launch::async , unwrapped(system_center_block()) , q[i] , 
-                            dataflow( hpx::launch::sync , unwrapped([](shared_vec v) 
-            { return (*v)[v->size()-1]; }) ,
-                                      q[i-1] ) , 
-                            dataflow( hpx::launch::sync , unwrapped([](shared_vec v) 
-            { return (*v)[0]; }) , q[i+1] ) ,
-                            dpdt[i] );
-    }
-    dpdt[N-1] = dataflow( hpx::launch::async , unwrapped(system_last_block()) , q[N-1] , 
-                          dataflow( hpx::launch::sync , unwrapped([](shared_vec v) 
-        { return (*v)[v->size()-1]; }), 
-                                    q[N-2] ) , 
-                          dpdt[N-1] );
-    // global barrier
-    wait_all( dpdt );
-
+// p += c*dpdt(q) with one task per block, used by fused_symplectic_stepper
+template< class Kappa , class Lambda , class State >
+void osc_chain_kick( const system_block< Kappa , Lambda > &block , 
+                     State &q , State &p , const double c ,
+                     const task_executor &executor )
+{
+    const size_t N = q.size();
+    const kick_block< Kappa , Lambda > kick( block.m_kappa , block.m_lambda , c );
+    const std::vector< shared_future< block_edges > > e = chain_edges( q , executor );
+    for( size_t i=0 ; i<N ; i++ )
+        p[i] = executor( bulk_task , unwrapped(kick) , q[i] , e[i] , e[i+2] , p[i] );
+    executor.stage( p );
 }
 
+template< class Kappa = kappa_type , class Lambda = lambda_type >
+struct osc_chain
+{
+    const system_block< Kappa , Lambda > m_block;
+    const shared_future< shared_vec > m_wall;
+    // per-block run times are accumulated here if not null
+    std::vector< double > *m_block_times;
+    const task_executor m_executor;
+    // split rhs of interior and bonds, see osc_chain_rhs
+    const bool m_split;
+
+    osc_chain( const Kappa kappa = Kappa() , const Lambda lambda = Lambda() ,
+               std::vector< double > *block_times = 0 ,
+               const task_executor &executor = task_executor::instance() ,
+               const bool split = false )
+        : m_block( kappa , lambda ) , m_wall( chain_wall() ) , m_block_times( block_times ) ,
+          m_executor( executor ) , m_split( split )
+    { }
+
+    // blocks of double or float
+    template< class Block >
+    void operator()( std::vector< shared_future< std::shared_ptr< Block > > > &q , 
+                     std::vector< shared_future< std::shared_ptr< Block > > > &dpdt ) const
+    {
+        osc_chain_rhs( m_block , q , dpdt , m_executor , m_block_times , m_split );
+    }
+
+    // fused force evaluation and momentum update p += c*dpdt(q)
+    template< class Block >
+    void kick( std::vector< shared_future< std::shared_ptr< Block > > > &q , 
+               std::vector< shared_future< std::shared_ptr< Block > > > &p , const double c ) const
+    {
+        osc_chain_kick( m_block , q , p , c , m_executor );
+    }
 
-double energy( const dvec &q , const dvec &p )
+    // versioned coordinate: one task per block without halo copies, the
+    // neighbors' versions stay valid until the task is done
+    template< size_t K >
+    void operator()( versioned_state< K > &q , state_type &dpdt ) const
+    {
+        static const shared_future< versioned_block< K > > wall = versioned_wall< K >();
+        const versioned_system_block< Kappa , Lambda > block( m_block );
+        const size_t N = q.size();
+        for( size_t i=0 ; i<N ; i++ )
+            dpdt[i] = m_executor( bulk_task , unwrapped(block) , 
+                                  ( i > 0 ) ? q[i-1] : wall , q[i] ,
+                                  ( i < N-1 ) ? q[i+1] : wall , dpdt[i] );
+        m_executor.stage( dpdt );
+    }
+
+    // capture mode: records one node per block that reads the block and its
+    // neighbors and writes dpdt, see task_graph.hpp
+    void operator()( graph_state &q , graph_state &dpdt ) const
+    {
+        const size_t N = q.size();
+        for( size_t i=0 ; i<N ; i++ )
+        {
+            const system_block< Kappa , Lambda > block = m_block;
+            const shared_vec x = q[i].data , d = dpdt[i].data;
+            const shared_vec q_l = ( i > 0 ) ? q[i-1].data : m_wall.get();
+            const shared_vec q_r = ( i < N-1 ) ? q[i+1].data : m_wall.get();
+            std::vector< size_t > reads , writes;
+            reads.push_back( q[i].resource );
+            if( i > 0 )
+                reads.push_back( q[i-1].resource );
+            if( i < N-1 )
+                reads.push_back( q[i+1].resource );
+            writes.push_back( dpdt[i].resource );
+            q[i].graph->add_node( [=]() { block( x , q_l->back() , q_r->front() , d ); } ,
+                                  reads , writes );
+        }
+    }
+};
+
+template< class Kappa = kappa_type , class Lambda = lambda_type >
+struct osc_chain_gb
 {
-    using checked_math::pow;
-    using std::abs;
+    const system_block< Kappa , Lambda > m_block;
+
+    osc_chain_gb( const Kappa kappa = Kappa() , const Lambda lambda = Lambda() )
+        : m_block( kappa , lambda )
+    { }
+
+    void operator()( state_type &q , state_type &dpdt ) const
+    {
+        osc_chain_rhs( m_block , q , dpdt , task_executor::instance() );
+        // global barrier
+        wait_all( dpdt );
+    }
+};
+
+
+template< class Kappa , class Lambda >
+double energy( const dvec &q , const dvec &p , const Kappa kappa , const Lambda lambda )
+{
+    const double K = kappa.value();
+    const double L = lambda.value();
     const size_t N = q.size();
-    double energy = 0.5*pow( abs(q[0]) , LAMBDA) / LAMBDA;
+    double energy = 0.5*lambda.pow( q[0] ) / L;
     for( size_t i=0 ; i<N-1 ; ++i )
     {
-        energy += 0.5*p[i]*p[i] + pow( q[i] , KAPPA ) / KAPPA
-            + pow( abs(q[i]-q[i+1]) , LAMBDA ) / LAMBDA;
+        energy += 0.5*p[i]*p[i] + kappa.pow( q[i] ) / K
+            + lambda.pow( q[i]-q[i+1] ) / L;
     }
-    energy += 0.5*p[N-1]*p[N-1] + pow( q[N-1] , KAPPA ) / KAPPA
-        + 0.5*pow( abs(q[N-1]) , LAMBDA) / LAMBDA;
+    energy += 0.5*p[N-1]*p[N-1] + kappa.pow( q[N-1] ) / K
+        + 0.5*lambda.pow( q[N-1] ) / L;
     return energy;
 }
 
-template< typename S >
-double energy( const S &q_fut , const S &p_fut )
+// energy of one block including the bond to its right neighbor,
+// the bonds to the walls at both ends of the chain count half
+template< class Kappa , class Lambda >
+struct block_energy
 {
-    dvec q,p;
-    for( size_t i=0 ; i<q_fut.size() ; ++i )
+    const Kappa m_kappa;
+    const Lambda m_lambda;
+    const bool m_first;
+    const bool m_last;
+
+    block_energy( const Kappa kappa , const Lambda lambda , 
+                  const bool first , const bool last )
+        : m_kappa( kappa ) , m_lambda( lambda ) , m_first( first ) , m_last( last )
+    { }
+
+    template< class Block >
+    double operator()( std::shared_ptr< Block > q_ , std::shared_ptr< Block > p_ , std::shared_ptr< Block > q_r ) const
     {
-        q.insert( q.end() , q_fut[i].get()->begin() , q_fut[i].get()->end() );
-        p.insert( p.end() , p_fut[i].get()->begin() , p_fut[i].get()->end() );
+        const Block &q = *q_;
+        const Block &p = *p_;
+        const double K = m_kappa.value();
+        const double L = m_lambda.value();
+        const size_t N = q.size();
+        double energy = m_first ? 0.5*m_lambda.pow( q[0] ) / L : 0.0;
+        for( size_t i=0 ; i<N-1 ; ++i )
+        {
+            energy += 0.5*p[i]*p[i] + m_kappa.pow( q[i] ) / K
+                + m_lambda.pow( q[i]-q[i+1] ) / L;
+        }
+        energy += 0.5*p[N-1]*p[N-1] + m_kappa.pow( q[N-1] ) / K;
+        if( m_last )
+            energy += 0.5*m_lambda.pow( q[N-1] ) / L;
+        else
+            energy += m_lambda.pow( q[N-1]-(*q_r)[0] ) / L;
+        return energy;
     }
-    return energy( q , p );
+};
+
+// passes x on after the energy tasks reading it are finished
+struct energy_fence
+{
+    template< class Block >
+    std::shared_ptr< Block > operator()( std::shared_ptr< Block > x , const double , const double ) const
+    {
+        return x;
+    }
+};
+
+// asynchronous energy: one task per block, summed in a tree. q and p are
+// fenced by the block energies so that later in-place updates wait for them.
+template< typename S , class Kappa , class Lambda >
+shared_future< double > energy( S &q , S &p , const Kappa kappa , const Lambda lambda ,
+                                const task_executor &executor = task_executor::instance() )
+{
+    const size_t N = q.size();
+    std::vector< shared_future< double > > e( N );
+    for( size_t i=0 ; i<N ; ++i )
+        e[i] = executor( bulk_task , 
+                         unwrapped( block_energy< Kappa , Lambda >( kappa , lambda , i==0 , i==N-1 ) ) ,
+                         q[i] , p[i] , ( i < N-1 ) ? q[i+1] : q[i] );
+    const shared_future< double > total = tree_sum( e );
+    for( size_t i=0 ; i<N ; ++i )
+    {
+        q[i] = executor.sync( unwrapped( energy_fence() ) , 
+                              q[i] , e[i] , ( i > 0 ) ? e[i-1] : e[i] );
+        p[i] = executor.sync( unwrapped( energy_fence() ) , p[i] , e[i] , e[i] );
+    }
+    return total;
+}
+
+template< typename S >
+shared_future< double > energy( S &q , S &p )
+{
+    return energy( q , p , kappa_type() , lambda_type() );
 }
 
 #endif
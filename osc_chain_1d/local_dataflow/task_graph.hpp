@@ -0,0 +1,249 @@
+// Copyright 2013 Mario Mulansky
+// capture and replay of the task graph of futurized time steps.
+// the stepper is run once on graph_state, which records every block operation
+// (algebra updates and rhs blocks including their halo reads) as a node
+// together with its read/write dependencies instead of executing it.
+// replay() then executes the recorded nodes on the same data without
+// constructing any dataflow objects.
+#ifndef TASK_GRAPH_HPP
+#define TASK_GRAPH_HPP
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+
+#include <boost/numeric/odeint/util/state_wrapper.hpp>
+#include <boost/numeric/odeint/util/is_resizeable.hpp>
+#include <boost/numeric/odeint/util/resize.hpp>
+#include <boost/numeric/odeint/util/same_size.hpp>
+
+#include <hpx/apply.hpp>
+#include <hpx/lcos/local/promise.hpp>
+
+#include "../../common/aligned_allocator.hpp"
+
+using hpx::lcos::shared_future;
+
+typedef aligned_dvec dvec;
+typedef std::shared_ptr< dvec > shared_vec;
+typedef std::vector< shared_future< shared_vec > > state_type;
+
+class task_graph
+{
+public:
+
+    typedef std::function< void() > work_type;
+
+    task_graph()
+        : m_num_counters( 0 ) , m_remaining( 0 ) , m_done( 0 )
+    { }
+
+    // a new piece of data (one block of one state) whose accesses are tracked
+    size_t add_resource()
+    {
+        m_last_writer.push_back( -1 );
+        m_readers.push_back( std::vector< size_t >() );
+        return m_last_writer.size()-1;
+    }
+
+    // records a node that reads and writes the given resources,
+    // it depends on the last writer of everything it touches (read after write,
+    // write after write) and on all readers of what it writes (write after read)
+    size_t add_node( const work_type &work ,
+                     const std::vector< size_t > &reads ,
+                     const std::vector< size_t > &writes )
+    {
+        const size_t n = m_work.size();
+        std::vector< size_t > deps;
+        for( size_t i=0 ; i<reads.size() ; ++i )
+            if( m_last_writer[reads[i]] >= 0 )
+                deps.push_back( m_last_writer[reads[i]] );
+        for( size_t i=0 ; i<writes.size() ; ++i )
+        {
+            if( m_last_writer[writes[i]] >= 0 )
+                deps.push_back( m_last_writer[writes[i]] );
+            deps.insert( deps.end() , m_readers[writes[i]].begin() , m_readers[writes[i]].end() );
+        }
+        std::sort( deps.begin() , deps.end() );
+        deps.erase( std::unique( deps.begin() , deps.end() ) , deps.end() );
+
+        m_work.push_back( work );
+        m_successors.push_back( std::vector< size_t >() );
+        m_num_deps.push_back( deps.size() );
+        for( size_t i=0 ; i<deps.size() ; ++i )
+            m_successors[deps[i]].push_back( n );
+
+        for( size_t i=0 ; i<reads.size() ; ++i )
+            m_readers[reads[i]].push_back( n );
+        for( size_t i=0 ; i<writes.size() ; ++i )
+        {
+            m_last_writer[writes[i]] = n;
+            m_readers[writes[i]].clear();
+        }
+        return n;
+    }
+
+    size_t size() const
+    {
+        return m_work.size();
+    }
+
+    // executes all recorded nodes once and returns when all are finished
+    void replay()
+    {
+        const size_t N = m_work.size();
+        if( N == 0 )
+            return;
+        if( m_num_counters != N )
+        {
+            m_counters.reset( new std::atomic< size_t >[N] );
+            m_num_counters = N;
+        }
+        for( size_t n=0 ; n<N ; ++n )
+            m_counters[n] = m_num_deps[n];
+        m_remaining = N;
+
+        hpx::lcos::local::promise< void > done;
+        m_done = &done;
+        for( size_t n=0 ; n<N ; ++n )
+            if( m_num_deps[n] == 0 )
+                spawn( n );
+        done.get_future().wait();
+        // all tasks are done, none of them uses the promise any more
+        m_done = 0;
+    }
+
+private:
+
+    void spawn( const size_t n )
+    {
+        hpx::apply( [this,n]() { run( n ); } );
+    }
+
+    void run( const size_t n )
+    {
+        m_work[n]();
+        const std::vector< size_t > &succ = m_successors[n];
+        for( size_t i=0 ; i<succ.size() ; ++i )
+            if( --m_counters[succ[i]] == 0 )
+                spawn( succ[i] );
+        if( --m_remaining == 0 )
+            m_done->set_value();
+    }
+
+    std::vector< work_type > m_work;
+    std::vector< std::vector< size_t > > m_successors;
+    std::vector< size_t > m_num_deps;
+
+    // access history of the resources during capture
+    std::vector< long > m_last_writer;
+    std::vector< std::vector< size_t > > m_readers;
+
+    std::unique_ptr< std::atomic< size_t >[] > m_counters;
+    size_t m_num_counters;
+    std::atomic< size_t > m_remaining;
+    hpx::lcos::local::promise< void > *m_done;
+};
+
+
+// one block of a state during capture: the data plus its resource id
+struct graph_block
+{
+    shared_vec data;
+    size_t resource;
+    task_graph *graph;
+};
+
+typedef std::vector< graph_block > graph_state;
+
+// graph_state on the same data as x, all futures in x have to be ready
+inline graph_state make_graph_state( task_graph &graph , const state_type &x )
+{
+    graph_state s( x.size() );
+    for( size_t i=0 ; i<x.size() ; ++i )
+    {
+        graph_block b = { x[i].get() , graph.add_resource() , &graph };
+        s[i] = b;
+    }
+    return s;
+}
+
+
+// records one node per block
+struct graph_algebra
+{
+    template< typename S , typename Op >
+    void for_each3( S &s1 , const S &s2 , const S &s3 , Op op )
+    {
+        const size_t N = boost::size( s1 );
+        for( size_t i=0 ; i<N ; ++i )
+        {
+            const shared_vec x1 = s1[i].data , x2 = s2[i].data , x3 = s3[i].data;
+            std::vector< size_t > reads , writes;
+            reads.push_back( s2[i].resource );
+            reads.push_back( s3[i].resource );
+            writes.push_back( s1[i].resource );
+            s1[i].graph->add_node( [=]() { op( x1 , x2 , x3 ); } , reads , writes );
+        }
+    }
+};
+
+
+namespace boost {
+namespace numeric {
+namespace odeint {
+
+template<>
+struct is_resizeable< graph_state >
+{
+    typedef boost::true_type type;
+    const static bool value = type::value;
+};
+
+template<>
+struct same_size_impl< graph_state , graph_state >
+{
+    static bool same_size( const graph_state &x1 ,
+                           const graph_state &x2 )
+    {
+        return ( ( x1.size() == x2.size() ) );
+    }
+};
+
+// temporaries of the stepper become new resources in the graph
+template<>
+struct resize_impl< graph_state , graph_state >
+{
+    static void resize( graph_state &x1 ,
+                        const graph_state &x2 )
+    {
+        x1.resize( x2.size() );
+        for( size_t i=0 ; i < x2.size() ; ++i )
+        {
+            graph_block b = { std::make_shared<dvec>( x2[i].data->size() ) ,
+                              x2[i].graph->add_resource() , x2[i].graph };
+            x1[i] = b;
+        }
+    }
+};
+
+} } }
+
+
+// records steps time steps of stepper on the data of q and p, the system has
+// to provide an operator() for graph_state as well
+template< class Stepper , class System >
+void capture( task_graph &graph , Stepper &stepper , System system ,
+              const state_type &q , const state_type &p ,
+              const double dt , const size_t steps )
+{
+    graph_state gq = make_graph_state( graph , q );
+    graph_state gp = make_graph_state( graph , p );
+    for( size_t n=0 ; n<steps ; ++n )
+        stepper.do_step( system , std::make_pair( boost::ref(gq) , boost::ref(gp) ) ,
+                         n*dt , dt );
+}
+
+#endif
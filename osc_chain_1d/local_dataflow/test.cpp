@@ -23,6 +23,8 @@
 #include "initialize.hpp"
 #include "system.hpp"
 
+#include "../../common/aligned_allocator.hpp"
+
 using hpx::lcos::future;
 using hpx::find_here;
 using hpx::lcos::wait;
@@ -33,7 +35,7 @@ using hpx::util::unwrapped;
 
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 
-typedef std::vector< double > dvec;
+typedef aligned_dvec dvec;
 typedef std::shared_ptr< dvec > shared_vec;
 typedef std::vector< future< shared_vec > > state_type;
 
@@ -86,11 +88,11 @@ int hpx_main(boost::program_options::variables_map& vm)
     wait( q_in );
     wait( p_in );
     std::clog.precision(10);
-    std::clog << "Initialization complete, energy: " << energy( q_in , p_in ) << std::endl;
+    std::clog << "Initialization complete, energy: " << energy( q_in , p_in ).get() << std::endl;
 
     hpx::util::high_resolution_timer timer;
 
-    integrate_n_steps( stepper_type() , osc_chain , 
+    integrate_n_steps( stepper_type() , osc_chain<>() , 
                        std::make_pair( boost::ref(q_in) , boost::ref(p_in) ) ,
                        0.0 , dt , steps );
 
@@ -101,7 +103,7 @@ int hpx_main(boost::program_options::variables_map& vm)
 
     hpx::cout << (boost::format("runtime: %fs\n") %timer.elapsed()) << hpx::flush;
 
-    std::clog << "Integration complete, energy: " << energy( q_in , p_in ) << std::endl;
+    std::clog << "Integration complete, energy: " << energy( q_in , p_in ).get() << std::endl;
 
     std::cout.precision(10);
 
@@ -0,0 +1,167 @@
+// Copyright 2013 Mario Mulansky
+// multi-versioned blocks of the coordinate q. each block owns a ring of K
+// buffers and version v of the block lives in buffer v%K. a version is only
+// read through a const handle, the update to version v+1 writes the next
+// buffer. so the update never overwrites the values that the rhs tasks of
+// the neighbors read from version v, and the rhs reads the neighbor blocks
+// in place, without halo copies or fences.
+// the stepper orders the write of version v+2 after all readers of version
+// v: it needs the momenta of the neighbors, which are updated with forces
+// computed from v. two versions are enough for the chain, more leave room
+// for deeper pipelining.
+#ifndef VERSIONED_STATE_HPP
+#define VERSIONED_STATE_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <boost/array.hpp>
+
+#include <hpx/lcos/future.hpp>
+
+#include "../../common/block_pool.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/numa_placement.hpp"
+#include "../../common/quiescence.hpp"
+#include "local_dataflow_shared_operations.hpp"
+
+using hpx::lcos::shared_future;
+using hpx::make_ready_future;
+
+typedef aligned_dvec dvec;
+typedef std::shared_ptr< dvec > shared_vec;
+
+template< size_t K >
+class version_ring
+{
+public:
+
+    static_assert( K >= 2 , "a single buffer would be updated in place" );
+
+    void resize( const size_t n )
+    {
+        for( size_t k=0 ; k<K ; ++k )
+            m_buffers[k].resize( n );
+    }
+
+    size_t size() const { return m_buffers[0].size(); }
+
+    dvec& buffer( const size_t version ) { return m_buffers[version % K]; }
+
+private:
+    boost::array< dvec , K > m_buffers;
+};
+
+// handle of one version of a block, the values can only be read
+template< size_t K >
+class versioned_block
+{
+public:
+
+    typedef std::shared_ptr< version_ring< K > > ring_pointer;
+
+    versioned_block()
+        : m_version( 0 )
+    { }
+
+    versioned_block( const ring_pointer &ring , const size_t version )
+        : m_ring( ring ) , m_version( version )
+    { }
+
+    const dvec& operator*() const { return m_ring->buffer( m_version ); }
+    const dvec* operator->() const { return &m_ring->buffer( m_version ); }
+
+    size_t version() const { return m_version; }
+
+    bool operator==( const versioned_block &other ) const
+    {
+        return m_ring == other.m_ring && m_version == other.m_version;
+    }
+
+    // the buffer of the next version, this version stays readable
+    dvec& next() const { return m_ring->buffer( m_version+1 ); }
+
+    versioned_block advance() const { return versioned_block( m_ring , m_version+1 ); }
+
+private:
+    ring_pointer m_ring;
+    size_t m_version;
+};
+
+template< size_t K >
+using versioned_state = std::vector< shared_future< versioned_block< K > > >;
+
+
+// initial block with q = 0, placed on the home domain of its position
+template< size_t K >
+struct initialize_versioned_zero
+{
+    const size_t m_N;
+    const size_t m_block;
+    const size_t m_blocks;
+
+    initialize_versioned_zero( const size_t N , const size_t block = 0 , const size_t blocks = 1 )
+        : m_N( N ) , m_block( block ) , m_blocks( blocks )
+    { }
+
+    versioned_block< K > operator()( versioned_block< K > ) const
+    {
+        const numa_placement &numa = numa_placement::instance();
+        const size_t d = numa.domain( m_block , m_blocks );
+        typename versioned_block< K >::ring_pointer ring =
+            block_pool< version_ring< K > >::instance().acquire( d );
+        ring->resize( m_N );
+        for( size_t k=0 ; k<K ; ++k )
+        {
+            std::fill( ring->buffer( k ).begin() , ring->buffer( k ).end() , 0.0 );
+            numa.place_on( ring->buffer( k ) , d );
+        }
+        return versioned_block< K >( ring , 0 );
+    }
+};
+
+// the fixed ends q = 0 as a neighbor block, a single value that is made once
+// and kept in a static, so it is not taken from the pool.
+template< size_t K >
+shared_future< versioned_block< K > > versioned_wall()
+{
+    typename versioned_block< K >::ring_pointer ring = std::make_shared< version_ring< K > >();
+    ring->resize( 1 );
+    for( size_t k=0 ; k<K ; ++k )
+        ring->buffer( k )[0] = 0.0;
+    return make_ready_future( versioned_block< K >( ring , 0 ) );
+}
+
+
+// the coordinate update of the stepper writes the next version, the
+// momentum update is in place as before
+struct versioned_operations
+{
+    template< typename Fac1 , typename Fac2=Fac1 >
+    struct scale_sum2 : local_dataflow_shared_operations::scale_sum2< Fac1 , Fac2 >
+    {
+        typedef local_dataflow_shared_operations::scale_sum2< Fac1 , Fac2 > base_type;
+        using base_type::operator();
+
+        scale_sum2( Fac1 alpha1 , Fac2 alpha2 )
+            : base_type( alpha1 , alpha2 )
+        { }
+
+        template< size_t K >
+        versioned_block< K > operator()( versioned_block< K > x1 , const versioned_block< K > x2 ,
+                                         const shared_vec x3 ) const
+        {
+            // a zero increment keeps the version
+            if( this->m_alpha1 == 1 && x1 == x2 && all_zero( *x3 ) )
+                return x1;
+            const dvec &in = *x2;
+            dvec &out = x1.next();
+            for( size_t i=0 ; i<out.size() ; ++i )
+                out[i] = this->m_alpha1*in[i] + this->m_alpha2*(*x3)[i];
+            return x1.advance();
+        }
+    };
+};
+
+#endif
@@ -9,26 +9,7 @@
 
 #include <omp.h>
 
-#include <boost/math/special_functions/sign.hpp>
-
-
-namespace checked_math {
-    inline double pow( double x , double y )
-    {
-        if( x==0.0 )
-            // 0**y = 0, don't care for y = 0 or NaN
-            return 0.0;
-        using std::pow;
-        using std::abs;
-        return pow( abs(x) , y );
-    }
-}
-
-double signed_pow( double x , double k )
-{
-    using boost::math::sign;
-    return checked_math::pow( x , k ) * sign(x);
-}
+#include "../../common/checked_math.hpp"
 
 
 struct osc_chain {
@@ -0,0 +1,51 @@
+// Copyright 2013 Mario Mulansky
+// load balancing for chains with non-uniform cost per site: the blocks are
+// re-partitioned periodically according to the measured run times of the
+// rhs blocks, see ../../common/partition.hpp
+#ifndef BALANCE_HPP
+#define BALANCE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include <boost/numeric/odeint/integrate/integrate_n_steps.hpp>
+
+#include "../../common/partition.hpp"
+#include "system.hpp"
+#include "reblock.hpp"
+
+// initial partition of q and p into M blocks from per-site cost weights
+inline void partition_blocks( state_type &q , state_type &p ,
+                              const std::vector< double > &cost , const size_t M )
+{
+    const std::vector< size_t > sizes = partition_by_cost( cost , M );
+    reblock( q , sizes );
+    reblock( p , sizes );
+}
+
+// integrates steps steps and re-partitions q and p every interval steps,
+// keeping the number of blocks
+template< class Stepper , class Kappa , class Lambda >
+void integrate_balanced( state_type &q , state_type &p ,
+                         const Kappa kappa , const Lambda lambda , const double beta ,
+                         const double t , const double dt ,
+                         const size_t steps , const size_t interval )
+{
+    std::vector< double > block_times;
+    for( size_t n=0 ; n<steps ; n += interval )
+    {
+        block_times.assign( q.size() , 0.0 );
+        // new stepper, its temporaries have the old block sizes
+        boost::numeric::odeint::integrate_n_steps( Stepper() , 
+                                                   osc_chain< Kappa , Lambda >( kappa , lambda , beta , &block_times ) ,
+                                                   std::make_pair( std::ref(q) , std::ref(p) ) ,
+                                                   t+n*dt , dt , std::min( interval , steps-n ) );
+        const std::vector< size_t > sizes = 
+            partition_by_cost( site_cost( block_sizes( q ) , block_times ) , q.size() );
+        reblock( q , sizes );
+        reblock( p , sizes );
+    }
+}
+
+#endif
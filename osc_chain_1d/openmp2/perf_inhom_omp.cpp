@@ -13,6 +13,9 @@
 #include "system.hpp"
 #include "nested_omp_algebra.hpp"
 #include "resize.hpp"
+#include "balance.hpp"
+
+#include "../../common/aligned_allocator.hpp"
 
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 using boost::numeric::odeint::range_algebra;
@@ -20,7 +23,7 @@ using boost::numeric::odeint::range_algebra;
 using boost::timer::cpu_timer;
 using boost::timer::cpu_times;
 
-typedef std::vector< double > dvec;
+typedef aligned_dvec dvec;
 typedef std::vector< dvec > state_type;
 
 typedef symplectic_rkn_sb3a_mclachlan< state_type ,
@@ -52,6 +55,14 @@ int main( int argc , char* argv[] )
     int N_init = N;
     if( argc > 5 )
         N_init = atoi( argv[5] );
+    // re-partition the blocks by measured cost every rebalance steps
+    int rebalance = 0;
+    if( argc > 6 )
+        rebalance = atoi( argv[6] );
+    // 1: partition the initial blocks by cost instead of alternating G/2 and 3G/2
+    int partition = 0;
+    if( argc > 7 )
+        partition = atoi( argv[7] );
     
 
     int M = N/block_size;
@@ -68,16 +79,18 @@ int main( int argc , char* argv[] )
     for( size_t n=0 ; n<12 ; ++n )
     {
 
-        osc_chain system( KAPPA , LAMBDA , beta );
+        osc_chain<> system( KAPPA , LAMBDA , beta );
 
         // initialize
         state_type p_init( M );
+        size_t sites = 0;
 
         // fully random
         for( size_t i=0 ; i<M ; i++ )
         {
             int G_ = (i%2 == 0) ? G/2 : 3*G/2;
             p_init[i].resize( G_ );
+            sites += G_;
             std::uniform_real_distribution<double> distribution( 0.0 );
             std::mt19937 engine( i ); // Mersenne twister MT19937
             auto generator = std::bind( distribution , engine );
@@ -94,14 +107,22 @@ int main( int argc , char* argv[] )
             p[i] = p_init[i];
         }
 
+        // every site of the chain costs the same
+        if( partition )
+            partition_blocks( q , p , std::vector< double >( sites , 1.0 ) , M );
+
         //std::clog << "# Initial energy: " << system.energy( q , p ) << std::endl;
     
         cpu_timer timer;
 
-        integrate_n_steps( stepper_type() , 
-                           system , 
-                           std::make_pair( boost::ref(q) , boost::ref(p) ) , 
-                           0.0 , dt , steps );
+        if( rebalance > 0 )
+            integrate_balanced< stepper_type >( q , p , real_exponent( KAPPA ) , real_exponent( LAMBDA ) , beta ,
+                                                0.0 , dt , steps , rebalance );
+        else
+            integrate_n_steps( stepper_type() , 
+                               system , 
+                               std::make_pair( boost::ref(q) , boost::ref(p) ) , 
+                               0.0 , dt , steps );
 
         double run_time = static_cast<double>(timer.elapsed().wall)/(1000*1000*1000);
 
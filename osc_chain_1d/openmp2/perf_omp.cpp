@@ -13,6 +13,9 @@
 #include "system.hpp"
 #include "nested_omp_algebra.hpp"
 #include "resize.hpp"
+#include "reblock.hpp"
+#include "../../common/granularity_tuner.hpp"
+#include "../../common/aligned_allocator.hpp"
 
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 using boost::numeric::odeint::range_algebra;
@@ -20,7 +23,7 @@ using boost::numeric::odeint::range_algebra;
 using boost::timer::cpu_timer;
 using boost::timer::cpu_times;
 
-typedef std::vector< double > dvec;
+typedef aligned_dvec dvec;
 typedef std::vector< dvec > state_type;
 
 typedef symplectic_rkn_sb3a_mclachlan< state_type ,
@@ -35,11 +38,98 @@ const double KAPPA = 3.3;
 const double LAMBDA = 4.7;
 const double beta = 1.0;
 
+struct perf_run
+{
+    const int M;
+    const int G;
+    const int steps;
+    const double dt;
+    const int tune_steps;
+
+    double avrg_time;
+    double min_time;
+    // block size after tuning
+    int G_tuned;
+
+    perf_run( const int M_ , const int G_ , const int steps_ , const double dt_ ,
+              const int tune_steps_ )
+        : M( M_ ) , G( G_ ) , steps( steps_ ) , dt( dt_ ) , tune_steps( tune_steps_ ) ,
+          avrg_time( 0.0 ) , min_time( 1000000.0 ) , G_tuned( G_ )
+    { }
+
+    template< class Kappa , class Lambda >
+    void operator()( const Kappa kappa , const Lambda lambda )
+    {
+        for( size_t n=0 ; n<12 ; ++n )
+        {
+
+            osc_chain< Kappa , Lambda > system( kappa , lambda , beta );
+
+            // initialize
+            state_type p_init( M , dvec( G , 0.0 ) );
+
+            // fully random
+            for( size_t i=0 ; i<M ; i++ )
+            {
+                std::uniform_real_distribution<double> distribution( 0.0 );
+                std::mt19937 engine( i ); // Mersenne twister MT19937
+                auto generator = std::bind( distribution , engine );
+                std::generate( p_init[i].begin() , p_init[i].end() , generator );
+            }
+    
+            state_type q( M );
+            state_type p( M );
+    
+#pragma omp parallel for schedule( runtime )
+            for( size_t i=0 ; i<M ; i++ )
+            {
+                q[i] = dvec( G , 0.0 );
+                p[i] = p_init[i];
+            }
+
+            //std::cout << "# Initial energy: " << system.energy( q , p ) << std::endl;
+    
+            cpu_timer timer;
+
+            // the tuning trials are the first steps of the run
+            int steps_left = steps;
+            if( tune_steps > 0 )
+            {
+                reblock_trial< stepper_type , osc_chain< Kappa , Lambda > , state_type , reblocking >
+                    trial( q , p , system , dt , tune_steps , steps );
+                G_tuned = tune_granularity( trial , M*G , G , 1 , M*G/omp_get_max_threads() );
+                reblock( q , G_tuned );
+                reblock( p , G_tuned );
+                steps_left = std::max( 0 , steps - static_cast<int>( trial.m_steps_done ) );
+            }
+
+            integrate_n_steps( stepper_type() , 
+                               system , 
+                               std::make_pair( std::ref(q) , std::ref(p) ) , 
+                               0.0 , dt , steps_left );
+
+            double run_time = static_cast<double>(timer.elapsed().wall)/(1000*1000*1000);
+
+            if( n > 1 )
+            {
+                min_time = std::min( min_time , run_time );
+                avrg_time += run_time;
+            }
+
+            std::clog << "G: " << G_tuned << ", run " << n << ": " << run_time << std::endl;
+
+        }
+    }
+};
+
 int main( int argc , char* argv[] )
 {
     int N = 1024;
     int steps = 100;
     double dt = 0.01;
+    double kappa = KAPPA;
+    double lambda = LAMBDA;
+    int tune_steps = 0;
     if( argc > 1 )
         N = atoi( argv[1] );
     int block_size = N/4;
@@ -49,6 +139,13 @@ int main( int argc , char* argv[] )
         steps = atoi( argv[3] );
     if( argc > 4 )
         dt = atof( argv[4] );
+    if( argc > 5 )
+        kappa = atof( argv[5] );
+    if( argc > 6 )
+        lambda = atof( argv[6] );
+    // auto-tune G starting from block_size with this many steps per trial
+    if( argc > 7 )
+        tune_steps = atoi( argv[7] );
 
     int M = N/block_size;
     int G = block_size;
@@ -58,58 +155,10 @@ int main( int argc , char* argv[] )
     //omp_set_schedule( omp_sched_dynamic , block_size );
     omp_set_schedule( omp_sched_static , 1 );
 
-    double avrg_time = 0.0;
-    double min_time = 1000000.0;
-        
-    for( size_t n=0 ; n<12 ; ++n )
-    {
-
-        osc_chain system( KAPPA , LAMBDA , beta );
-
-        // initialize
-        state_type p_init( M , dvec( G , 0.0 ) );
-
-        // fully random
-        for( size_t i=0 ; i<M ; i++ )
-        {
-            std::uniform_real_distribution<double> distribution( 0.0 );
-            std::mt19937 engine( i ); // Mersenne twister MT19937
-            auto generator = std::bind( distribution , engine );
-            std::generate( p_init[i].begin() , p_init[i].end() , generator );
-        }
-    
-        state_type q( M );
-        state_type p( M );
-    
-#pragma omp parallel for schedule( runtime )
-        for( size_t i=0 ; i<M ; i++ )
-        {
-            q[i] = dvec( G , 0.0 );
-            p[i] = p_init[i];
-        }
-
-        //std::cout << "# Initial energy: " << system.energy( q , p ) << std::endl;
-    
-        cpu_timer timer;
-
-        integrate_n_steps( stepper_type() , 
-                           system , 
-                           std::make_pair( std::ref(q) , std::ref(p) ) , 
-                           0.0 , dt , steps );
-
-        double run_time = static_cast<double>(timer.elapsed().wall)/(1000*1000*1000);
-
-        if( n > 1 )
-        {
-            min_time = std::min( min_time , run_time );
-            avrg_time += run_time;
-        }
-
-        std::clog << "G: " << block_size << ", run " << n << ": " << run_time << std::endl;
-
-    }
+    perf_run run( M , G , steps , dt , tune_steps );
+    dispatch_exponents( kappa , lambda , run );
 
-    std::cout << block_size << '\t' << min_time << '\t' << avrg_time/(10) << std::endl;
+    std::cout << run.G_tuned << '\t' << run.min_time << '\t' << run.avrg_time/(10) << std::endl;
 
     return 0;
 }
@@ -14,13 +14,15 @@
 #include "nested_omp_algebra.hpp"
 #include "resize.hpp"
 
+#include "../../common/aligned_allocator.hpp"
+
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 using boost::numeric::odeint::range_algebra;
 
 using boost::timer::cpu_timer;
 using boost::timer::cpu_times;
 
-typedef std::vector< double > dvec;
+typedef aligned_dvec dvec;
 typedef std::vector< dvec > state_type;
 
 typedef symplectic_rkn_sb3a_mclachlan< state_type ,
@@ -63,7 +65,7 @@ int main( int argc , char* argv[] )
         
     for( size_t n=0 ; n<12 ; ++n )
     {
-        osc_chain system( KAPPA , LAMBDA , beta );
+        osc_chain<> system( KAPPA , LAMBDA , beta );
 
         // initialize
         state_type p_init( M , dvec( G , 0.0 ) );
@@ -0,0 +1,159 @@
+// Copyright 2013 Mario Mulansky
+//
+// the chain with openmp tasks that carry the per-block dependencies of the
+// hpx version, without barriers between the stages, see task_omp_algebra.hpp.
+// the producer runs at most lookahead steps ahead of the tasks: the queue of
+// an unbounded producer grows with the run and so does the cost of the
+// dependency tracking of the openmp runtime.
+
+#include <iostream>
+#include <vector>
+#include <random>
+
+#include <omp.h>
+
+#include <boost/numeric/odeint.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "system.hpp"
+#include "task_omp_algebra.hpp"
+#include "resize.hpp"
+#include "../../common/aligned_allocator.hpp"
+
+using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
+using boost::numeric::odeint::range_algebra;
+
+using boost::timer::cpu_timer;
+using boost::timer::cpu_times;
+
+typedef aligned_dvec dvec;
+typedef std::vector< dvec > state_type;
+
+typedef symplectic_rkn_sb3a_mclachlan< state_type ,
+                                       state_type ,
+                                       double ,
+                                       state_type ,
+                                       state_type ,
+                                       double ,
+                                       task_omp_algebra< range_algebra > > stepper_type;
+
+const double KAPPA = 3.3;
+const double LAMBDA = 4.7;
+const double beta = 1.0;
+
+struct perf_run
+{
+    const int M;
+    const int G;
+    const int steps;
+    const double dt;
+    const int lookahead;
+
+    double avrg_time;
+    double min_time;
+
+    perf_run( const int M_ , const int G_ , const int steps_ , const double dt_ ,
+              const int lookahead_ )
+        : M( M_ ) , G( G_ ) , steps( steps_ ) , dt( dt_ ) , lookahead( lookahead_ ) ,
+          avrg_time( 0.0 ) , min_time( 1000000.0 )
+    { }
+
+    template< class Kappa , class Lambda >
+    void operator()( const Kappa kappa , const Lambda lambda )
+    {
+        for( size_t n=0 ; n<12 ; ++n )
+        {
+
+            osc_chain_tasks< Kappa , Lambda > system( kappa , lambda , beta );
+
+            // initialize
+            state_type p_init( M , dvec( G , 0.0 ) );
+
+            // fully random
+            for( size_t i=0 ; i<M ; i++ )
+            {
+                std::uniform_real_distribution<double> distribution( 0.0 );
+                std::mt19937 engine( i ); // Mersenne twister MT19937
+                auto generator = std::bind( distribution , engine );
+                std::generate( p_init[i].begin() , p_init[i].end() , generator );
+            }
+
+            state_type q( M );
+            state_type p( M );
+
+#pragma omp parallel for schedule( runtime )
+            for( size_t i=0 ; i<M ; i++ )
+            {
+                q[i] = dvec( G , 0.0 );
+                p[i] = p_init[i];
+            }
+
+            cpu_timer timer;
+
+            // the stepper owns the temporaries the tasks write, it lives
+            // until the tasks are done at the end of the parallel region
+            stepper_type stepper;
+#pragma omp parallel
+#pragma omp single
+            for( int s=0 ; s<steps ; s += lookahead )
+            {
+                integrate_n_steps( boost::ref( stepper ) ,
+                                   boost::ref( system ) ,
+                                   std::make_pair( std::ref(q) , std::ref(p) ) ,
+                                   s*dt , dt , std::min( lookahead , steps-s ) );
+#pragma omp taskwait
+            }
+
+            double run_time = static_cast<double>(timer.elapsed().wall)/(1000*1000*1000);
+
+            if( n > 1 )
+            {
+                min_time = std::min( min_time , run_time );
+                avrg_time += run_time;
+            }
+
+            std::clog << "G: " << G << ", run " << n << ": " << run_time << std::endl;
+
+        }
+    }
+};
+
+int main( int argc , char* argv[] )
+{
+    int N = 1024;
+    int steps = 100;
+    double dt = 0.01;
+    double kappa = KAPPA;
+    double lambda = LAMBDA;
+    int lookahead = 4;
+    if( argc > 1 )
+        N = atoi( argv[1] );
+    int block_size = N/4;
+    if( argc > 2 )
+        block_size = atoi( argv[2] );
+    if( argc > 3 )
+        steps = atoi( argv[3] );
+    if( argc > 4 )
+        dt = atof( argv[4] );
+    if( argc > 5 )
+        kappa = atof( argv[5] );
+    if( argc > 6 )
+        lambda = atof( argv[6] );
+    // number of steps whose tasks are created before waiting for them
+    if( argc > 7 )
+        lookahead = std::max( 1 , atoi( argv[7] ) );
+
+    int M = N/block_size;
+    int G = block_size;
+
+    std::cout << "Size: " << N << " with " << block_size << " elements per task" << " and " << steps << " steps." << std::endl;
+
+    omp_set_schedule( omp_sched_static , 1 );
+
+    perf_run run( M , G , steps , dt , lookahead );
+    dispatch_exponents( kappa , lambda , run );
+
+    std::cout << G << '\t' << run.min_time << '\t' << run.avrg_time/(10) << std::endl;
+
+    return 0;
+}
@@ -6,13 +6,49 @@
 #include <functional>
 #include <random>
 #include <cmath>
+#include <cstring>
+
+#include <boost/math/special_functions/sign.hpp>
+#include <boost/timer/timer.hpp>
+
+#include "../../common/checked_math.hpp"
+
+using boost::timer::cpu_timer;
 
 typedef std::vector< double > dvec;
 
 const double KAPPA = 2.5;
 const double LAMBDA = 3.5;
 
-int main( int argc , char **argv ) 
+// the branching versions replaced by common/checked_math.hpp
+namespace branching_math {
+    inline double pow( double x , double y )
+    {
+        if( x==0.0 )
+            // 0**y = 0, don't care for y = 0 or NaN
+            return 0.0;
+        using std::pow;
+        using std::abs;
+        return pow( abs(x) , y );
+    }
+
+    inline double signed_pow( double x , double k )
+    {
+        using boost::math::sign;
+        return branching_math::pow( x , k ) * sign(x);
+    }
+}
+
+template< class F >
+double run( const dvec &x , dvec &y , F f )
+{
+    cpu_timer timer;
+    for( int n=0 ; n<10 ; n++ )
+        std::transform( x.begin() , x.end() , y.begin() , f );
+    return static_cast<double>(timer.elapsed().wall)/(1000*1000*1000);
+}
+
+int main( int argc , char **argv )
 {
     int N = 1024*1024;
     if( argc > 1 )
@@ -25,13 +61,30 @@ int main( int argc , char **argv )
     auto generator = std::bind( distribution , engine );
     std::generate( x.begin() , x.end() , generator );
 
-    for( int n=0 ; n<10 ; n++ )
+    double t = run( x , y , []( const double x ) -> double
+                    {
+                        const double y = std::pow( x , KAPPA );
+                        return std::pow( y , LAMBDA );
+                    } );
+    std::cout << "std::pow: " << t << "s" << std::endl;
+
+    // signed random input with a fraction of exact (+-)zeros at random
+    // positions, as in the partially excited chains of perf_part
+    std::cout << "# zeros\tbranching\tbranch-free\tidentical" << std::endl;
+    std::uniform_real_distribution<double> signed_distribution( -1.0 , 1.0 );
+    std::uniform_real_distribution<double> coin( 0.0 , 1.0 );
+    dvec y2( N );
+    for( int z=0 ; z<=4 ; ++z )
     {
-        std::transform( x.begin() , x.end() , y.begin() ,
-                        []( const double x ) -> double 
-                        { 
-                            const double y = std::pow( x , KAPPA );
-                            return std::pow( y , LAMBDA );
-                        } );
+        const double zeros = 0.25*z;
+        for( int i=0 ; i<N ; ++i )
+            x[i] = ( coin( engine ) < zeros ) ? ( ( i%2 ) ? 0.0 : -0.0 ) : signed_distribution( engine );
+
+        const double t_old = run( x , y , []( const double x ) -> double
+                                  { return branching_math::signed_pow( x , LAMBDA-1 ); } );
+        const double t_new = run( x , y2 , []( const double x ) -> double
+                                  { return checked_math::signed_pow( x , LAMBDA-1 ); } );
+        const bool identical = ( std::memcmp( &y[0] , &y2[0] , N*sizeof(double) ) == 0 );
+        std::cout << zeros << '\t' << t_old << '\t' << t_new << '\t' << identical << std::endl;
     }
 }
@@ -0,0 +1,62 @@
+// Copyright 2013 Mario Mulansky
+// changing the block size of the state, used for auto-tuning G
+
+#ifndef REBLOCK_HPP
+#define REBLOCK_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include "../../common/aligned_allocator.hpp"
+
+typedef aligned_dvec dvec;
+typedef std::vector< dvec > state_type;
+
+// redistributes x into blocks of the given sizes, the sizes have to add up
+// to the total size
+inline void reblock( state_type &x , const std::vector< size_t > &sizes )
+{
+    dvec data;
+    for( size_t i=0 ; i<x.size() ; ++i )
+        data.insert( data.end() , x[i].begin() , x[i].end() );
+    const size_t M = sizes.size();
+    std::vector< size_t > start( M+1 , 0 );
+    for( size_t i=0 ; i<M ; ++i )
+        start[i+1] = start[i] + sizes[i];
+    state_type y( M );
+#pragma omp parallel for schedule( runtime )
+    for( size_t i=0 ; i<M ; ++i )
+        y[i] = dvec( data.begin()+start[i] , data.begin()+start[i+1] );
+    x.swap( y );
+}
+
+// blocks of G elements, the total size has to be a multiple of G
+inline void reblock( state_type &x , const size_t G )
+{
+    size_t N = 0;
+    for( size_t i=0 ; i<x.size() ; ++i )
+        N += x[i].size();
+    reblock( x , std::vector< size_t >( N/G , G ) );
+}
+
+inline std::vector< size_t > block_sizes( const state_type &x )
+{
+    std::vector< size_t > sizes( x.size() );
+    for( size_t i=0 ; i<x.size() ; ++i )
+        sizes[i] = x[i].size();
+    return sizes;
+}
+
+// blocking of the state for reblock_trial, the steps are done on return
+struct reblocking
+{
+    void operator()( state_type &x , const size_t G ) const
+    {
+        reblock( x , G );
+    }
+
+    void wait( state_type & ) const
+    { }
+};
+
+#endif
@@ -5,10 +5,12 @@
 
 #include <boost/numeric/odeint/util/resize.hpp>
 
+#include "../../common/aligned_allocator.hpp"
+
 namespace boost { namespace numeric { namespace odeint {
 
 
-typedef std::vector< double > dvec;
+typedef aligned_dvec dvec;
 typedef std::vector< dvec > state_type;
 
 
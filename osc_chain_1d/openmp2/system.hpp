@@ -5,67 +5,55 @@
 
 #include <vector>
 #include <cmath>
+#include <algorithm>
 #include <iostream>
 
 #include <omp.h>
 
-#include <boost/math/special_functions/sign.hpp>
+#include "../../common/checked_math.hpp"
+#include "../../common/exponent_policy.hpp"
+#include "../../common/chain_kernels.hpp"
+#include "../../common/quiescence.hpp"
+#include "../../common/aligned_allocator.hpp"
 
-typedef std::vector< double > dvec;
-
-namespace checked_math {
-    inline double pow( double x , double y )
-    {
-        if( x==0.0 )
-            // 0**y = 0, don't care for y = 0 or NaN
-            return 0.0;
-        using std::pow;
-        using std::abs;
-        return pow( abs(x) , y );
-    }
-}
-
-double signed_pow( double x , double k )
-{
-    using boost::math::sign;
-    return checked_math::pow( x , k ) * sign(x);
-}
+typedef aligned_dvec dvec;
 
+template< class Kappa , class Lambda >
 struct rhs_func {
-    const double m_kap;
-    const double m_lam;
+    const Kappa m_kap;
+    const Lambda m_lam;
     
-    rhs_func( const double kap , const double lam )
+    rhs_func( const Kappa kap , const Lambda lam )
         : m_kap( kap ) , m_lam( lam ) 
     { }
 
     void operator()( dvec &dpdt , const dvec &q , double q_l , double q_r )
     {
-        const size_t N = q.size();
-        double coupling_lr = signed_pow( q_l - q[0] , m_lam-1 );
-        for( size_t i=0 ; i<N-1 ; ++i )
+        // quiescent block, the force vanishes
+        if( q_l == 0.0 && q_r == 0.0 && all_zero( q ) )
         {
-            dpdt[i] = dpdt[i] = -signed_pow( q[i] , m_kap-1 )
-                + coupling_lr;
-            coupling_lr = signed_pow( q[i] - q[i+1] , m_lam-1 );
-            dpdt[i] -= coupling_lr;
+            std::fill( dpdt.begin() , dpdt.end() , 0.0 );
+            return;
         }
-        dpdt[N-1] = dpdt[N-1] = -signed_pow( q[N-1] , m_kap-1 )
-                + coupling_lr - signed_pow( q[N-1] - q_r , m_lam-1 );
+        chain_kernels::block_rhs( &q[0] , &dpdt[0] , q.size() , 
+                                  q_l , q_r , m_kap.minus_one() , m_lam.minus_one() );
     }
 };
 
+template< class Kappa = real_exponent , class Lambda = real_exponent >
 struct osc_chain {
 
     const double m_beta;
-    const double m_kap;
-    const double m_lam;
+    const Kappa m_kap;
+    const Lambda m_lam;
     int m_threads;
+    // per-block run times are accumulated here if not null
+    std::vector< double > *m_block_times;
 
-    osc_chain( const double kap , const double lam , 
-            const double beta )
+    osc_chain( const Kappa kap , const Lambda lam , 
+            const double beta , std::vector< double > *block_times = 0 )
         : m_kap( kap ) , m_lam( lam ) , m_beta( beta ) , 
-          m_threads(0)
+          m_threads(0) , m_block_times( block_times )
     { }
 
     template< class StateIn , class StateOut >
@@ -74,29 +62,35 @@ struct osc_chain {
         // std::cout << "system" << std::endl;
         // q and dpdt are 2d
         const int N = q.size();
+        if( m_block_times != 0 )
+            m_block_times->resize( N , 0.0 );
 
 #ifndef NO_OMP
 #pragma omp parallel for schedule(runtime)
 #endif	
         for( int i=0 ; i<N ; ++i )
         {
-            rhs_func f( m_kap , m_lam );
+            const double t0 = ( m_block_times != 0 ) ? omp_get_wtime() : 0.0;
+            rhs_func< Kappa , Lambda > f( m_kap , m_lam );
             if( i==0 )
                 f( dpdt[i] , q[i] , 0.0 , q[i+1][0] );
             else if ( i<N-1 )
                 f( dpdt[i] , q[i] , q[i-1][q[i-1].size()-1] , q[i+1][0] );
             else
                 f( dpdt[i] , q[i] , q[i-1][q[i-1].size()-1] , 0.0 );
+            if( m_block_times != 0 )
+                (*m_block_times)[i] += omp_get_wtime() - t0;
         }
     }
 
     template< class StateIn >
     double energy( const StateIn &q , const StateIn &p )
     {
-        using checked_math::pow;
         // q and dpdt are 2d
         const size_t N = q.size();
-        double energy = 0.5*pow( q[0][0] , m_lam ) / m_lam;;
+        const double kap = m_kap.value();
+        const double lam = m_lam.value();
+        double energy = 0.5*m_lam.pow( q[0][0] ) / lam;;
 #ifndef NO_OMP
 #pragma omp parallel
         {
@@ -114,19 +108,48 @@ struct osc_chain {
                 for( size_t j=0 ; j<M-1 ; ++j )
                 {
                     energy += p[i][j]*p[i][j] / 2.0
-                        + pow( q[i][j] , m_kap ) / m_kap
-                        + pow( q[i][j]-q[i][j+1] , m_lam ) / m_lam;
+                        + m_kap.pow( q[i][j] ) / kap
+                        + m_lam.pow( q[i][j]-q[i][j+1] ) / lam;
                 }
                 energy += p[i][M-1]*p[i][M-1] / 2.0
-                    + pow( q[i][M-1] , m_kap ) / m_kap;
+                    + m_kap.pow( q[i][M-1] ) / kap;
                 if( i<N-1 )
-                    energy += pow( q[i][M-1]-q[i+1][0] , m_lam ) / m_lam;
+                    energy += m_lam.pow( q[i][M-1]-q[i+1][0] ) / lam;
                 else
-                    energy += 0.5*pow( q[i][M-1] , m_lam ) / m_lam;
+                    energy += 0.5*m_lam.pow( q[i][M-1] ) / lam;
             }
         }
         return energy;
     }
 };
 
+// one task per block with the dependencies of the hpx version: the task of
+// block i reads q of the block and its neighbors and writes dpdt[i]. the
+// neighbors are read in place, their next update waits for the task. to be
+// used with task_omp_algebra, inside a single region.
+template< class Kappa = real_exponent , class Lambda = real_exponent >
+struct osc_chain_tasks : osc_chain< Kappa , Lambda >
+{
+    osc_chain_tasks( const Kappa kap , const Lambda lam , const double beta )
+        : osc_chain< Kappa , Lambda >( kap , lam , beta )
+    { }
+
+    template< class StateIn , class StateOut >
+    void operator()( const StateIn &q , StateOut &dpdt )
+    {
+        const int N = q.size();
+        rhs_func< Kappa , Lambda > f( this->m_kap , this->m_lam );
+        for( int i=0 ; i<N ; ++i )
+        {
+            // the fixed ends are not read, the block itself stands in
+            const dvec *q_l = &q[ ( i > 0 ) ? i-1 : i ];
+            const dvec *q_i = &q[i];
+            const dvec *q_r = &q[ ( i < N-1 ) ? i+1 : i ];
+            dvec *d = &dpdt[i];
+#pragma omp task firstprivate( f , q_l , q_i , q_r , d , i ) depend( in: q_l[0] , q_i[0] , q_r[0] ) depend( out: d[0] )
+            f( *d , *q_i , ( i > 0 ) ? q_l->back() : 0.0 , ( i < N-1 ) ? q_r->front() : 0.0 );
+        }
+    }
+};
+
 #endif
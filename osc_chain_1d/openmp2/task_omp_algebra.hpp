@@ -0,0 +1,35 @@
+/* nested range algebra with one task per block */
+
+#ifndef TASK_OMP_ALGEBRA_HPP
+#define TASK_OMP_ALGEBRA_HPP
+
+// the update of block i is a task that writes s1[i] and reads s2[i] and
+// s3[i]. the blocks themselves are the dependency handles, so the tasks
+// are ordered like the dataflows of the hpx version and there is no barrier
+// after the update. the algebra only creates the tasks: it has to be called
+// from a single region of a parallel region, whose end waits for them. the
+// stepper has to outlive that region, it owns blocks the tasks write.
+template< class InnerAlgebra >
+struct task_omp_algebra
+{
+
+    template< class S1 , class S2 , class S3 , class Op >
+    void for_each3( S1 &s1 , S2 &s2 , S3 &s3 , Op op )
+    {
+        InnerAlgebra inner = m_inner_algebra;
+        for( size_t i=0 ; i<boost::size(s1) ; ++i )
+        {
+            auto *x1 = &s1[i];
+            auto *x2 = &s2[i];
+            auto *x3 = &s3[i];
+#pragma omp task firstprivate( x1 , x2 , x3 , op , inner ) depend( inout: x1[0] ) depend( in: x2[0] , x3[0] )
+            inner.for_each3( *x1 , *x2 , *x3 , op );
+        }
+    }
+
+
+private:
+    InnerAlgebra m_inner_algebra;
+};
+
+#endif
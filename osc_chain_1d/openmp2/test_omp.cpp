@@ -12,13 +12,15 @@
 #include "nested_omp_algebra.hpp"
 #include "resize.hpp"
 
+#include "../../common/aligned_allocator.hpp"
+
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 using boost::numeric::odeint::range_algebra;
 
 using boost::timer::auto_cpu_timer;
 using boost::timer::cpu_times;
 
-typedef std::vector< double > dvec;
+typedef aligned_dvec dvec;
 typedef std::vector< dvec > state_type;
 
 typedef symplectic_rkn_sb3a_mclachlan< state_type ,
@@ -78,7 +80,7 @@ int main( int argc , char* argv[] )
         p[i] = p_init[i];
     }
 
-    osc_chain sys( KAPPA , LAMBDA , beta );
+    osc_chain<> sys( KAPPA , LAMBDA , beta );
 
     std::cout << "Initial energy: " << sys.energy( q , p ) << std::endl;
 
@@ -7,42 +7,24 @@
 #include <memory>
 #include <cmath>
 
-#include <boost/math/special_functions/sign.hpp>
-
 #include <hpx/runtime/actions/plain_action.hpp>
 #include <hpx/components/dataflow/dataflow.hpp>
 #include <hpx/lcos/async.hpp>
 #include <hpx/include/iostreams.hpp>
 
+#include "../../common/checked_math.hpp"
+#include "../../common/async_reduce.hpp"
 #include "hpx_odeint_actions.hpp"
 
 using hpx::lcos::dataflow;
 using hpx::lcos::dataflow_base;
 using hpx::find_here;
 using hpx::lcos::wait;
+using hpx::lcos::future;
 
 const double KAPPA = 3.5;
 const double LAMBDA = 4.5;
 
-namespace checked_math {
-    inline double pow( double x , double y )
-    {
-        if( x==0.0 )
-            // 0**y = 0, don't care for y = 0 or NaN
-            return 0.0;
-        using std::pow;
-        using std::abs;
-        return pow( abs(x) , y );
-    }
-}
-
-double signed_pow( double x , double k )
-{
-    using boost::math::sign;
-    using std::abs;
-    return checked_math::pow( x , k ) * sign(x);
-}
-
 typedef std::vector< double > dvec;
 typedef std::vector< dvec > dvecvec;
 typedef std::shared_ptr< dvecvec > shared_vecvec;
@@ -280,19 +262,56 @@ double energy( const dvecvec &q , const dvecvec &p )
     return energy;
 }
 
-template< typename S >
-double energy( const S &q_fut , const S &p_fut )
+// energy of one block of rows including the vertical bonds to the first
+// row of the next block
+struct block_energy
 {
-    dvecvec q,p;
-    for( size_t i=0 ; i<q_fut.size() ; ++i )
+    const bool m_last;
+
+    block_energy( const bool last )
+        : m_last( last )
+    { }
+
+    double operator()( shared_vecvec q_ , shared_vecvec p_ , shared_vecvec q_d ) const
     {
-        for( size_t j=0 ; j<(*(q_fut[i].get())).size() ; ++j )
+        using checked_math::pow;
+        using std::abs;
+        const dvecvec &q = *q_;
+        const dvecvec &p = *p_;
+        const size_t N = q.size();
+        double energy = 0.0;
+        for( size_t i=0 ; i<N ; ++i )
         {
-            q.push_back( (*(q_fut[i].get()))[j] );
-            p.push_back( (*(p_fut[i].get()))[j] );
+            const size_t M = q[i].size();
+            // the row below, none for the last row of the lattice
+            const dvec *d = ( i < N-1 ) ? &q[i+1] : ( m_last ? 0 : &(*q_d)[0] );
+            for( size_t j=0 ; j<M-1 ; ++j )
+            {
+                energy += 0.5*p[i][j]*p[i][j] + pow( q[i][j] , KAPPA ) / KAPPA
+                    + pow( abs(q[i][j]-q[i][j+1]) , LAMBDA ) / LAMBDA;
+                if( d != 0 )
+                    energy += pow( abs(q[i][j]-(*d)[j]) , LAMBDA ) / LAMBDA;
+            }
+            energy += 0.5*p[i][M-1]*p[i][M-1] + pow( q[i][M-1] , KAPPA ) / KAPPA;
+            if( d != 0 )
+                energy += pow( abs(q[i][M-1]-(*d)[M-1]) , LAMBDA ) / LAMBDA;
         }
+        return energy;
     }
-    return energy( q , p );
+};
+
+// asynchronous energy of the futures of the blocks: one local task per block,
+// summed in a tree. the blocks must not be updated before the result is ready.
+template< typename S >
+future< double > energy( const S &q , const S &p )
+{
+    const size_t N = q.size();
+    std::vector< future< double > > e( N );
+    for( size_t i=0 ; i<N ; ++i )
+        e[i] = hpx::lcos::local::dataflow( hpx::launch::async , 
+                                           hpx::util::unwrapped( block_energy( i==N-1 ) ) ,
+                                           q[i] , p[i] , ( i < N-1 ) ? q[i+1] : q[i] );
+    return tree_sum( e );
 }
 
 #endif
@@ -179,7 +179,7 @@ int hpx_main(boost::program_options::variables_map& vm)
     wait( futures_q );
     wait( futures_p );
     std::clog.precision(10);
-    std::clog << "Initialization complete, energy: " << energy( futures_q , futures_p ) << std::endl;
+    std::clog << "Initialization complete, energy: " << energy( futures_q , futures_p ).get() << std::endl;
 
     // std::cout.precision(10);
 
@@ -234,7 +234,7 @@ int hpx_main(boost::program_options::variables_map& vm)
 
     hpx::cout << (boost::format("runtime: %fs\n") %timer.elapsed()) << hpx::flush;
 
-    std::clog << "Integration complete, energy: " << energy( futures_q , futures_p ) << std::endl;
+    std::clog << "Integration complete, energy: " << energy( futures_q , futures_p ).get() << std::endl;
 
     std::cout.precision(10);
 
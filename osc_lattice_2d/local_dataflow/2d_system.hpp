@@ -6,6 +6,7 @@
 #include <vector>
 #include <memory>
 #include <cmath>
+#include <algorithm>
 
 #include <boost/math/special_functions/sign.hpp>
 #include <boost/thread/thread.hpp>
@@ -15,293 +16,335 @@
 #include <hpx/include/iostreams.hpp>
 #include <hpx/util/unwrapped.hpp>
 
+#include "../../common/checked_math.hpp"
+#include "../../common/exponent_policy.hpp"
+#include "../../common/quiescence.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/tile.hpp"
+#include "../../common/block_pool.hpp"
+#include "../../common/task_executor.hpp"
+#include "../../common/async_reduce.hpp"
+
 using hpx::lcos::local::dataflow;
 using hpx::lcos::future;
 using hpx::lcos::wait;
+using hpx::make_ready_future;
 using hpx::util::unwrapped;
 
 const double KAPPA = 3.3;
 const double LAMBDA = 4.7;
 
-namespace checked_math {
-    inline double pow( double x , double y )
-    {
-        if( x==0.0 )
-            // 0**y = 0, don't care for y = 0 or NaN
-            return 0.0;
-        using std::pow;
-        using std::abs;
-        return pow( abs(x) , y );
-    }
-}
-
-double signed_pow( double x , double k )
-{
-    using boost::math::sign;
-    using std::abs;
-    return checked_math::pow( x , k ) * sign(x);
-}
-
-typedef std::vector< double > dvec;
-typedef std::vector< dvec > dvecvec;
+typedef aligned_dvec dvec;
+typedef tile dvecvec;
 typedef std::shared_ptr< dvecvec > shared_vecvec;
 typedef std::vector< future< shared_vec > > state_type;
-
-struct system_first_block
+// forces of the bonds of one edge of a tile
+typedef std::shared_ptr< dvec > shared_row;
+
+// zero-copy halo: an outer row or column of a neighbor tile, read in place.
+// the view holds the neighbor's tile of the q version it was taken from. the
+// coordinate update writes the next version into another tile (see
+// next_version), so the values stay valid as long as the view lives.
+// columns are read with the row stride of the tile. empty at the boundary of
+// the lattice.
+class halo_view
 {
-    shared_vecvec operator()( shared_vecvec q , const dvec q_d , shared_vecvec dpdt ) const
-    {
-        //hpx::cout << (boost::format("first block\n") ) << hpx::flush;
+public:
 
-        const size_t N = q->size();
+    halo_view()
+        : m_data( 0 ) , m_stride( 0 ) , m_size( 0 )
+    { }
 
-        double coupling_lr = 0.0;
-        const size_t M = (*q)[0].size();
-        dvec coupling_ud( M , 0.0 );
-        for( size_t i=0 ; i<N-1 ; ++i )
-        {
-            for( size_t j=0 ; j<M-1 ; ++j )
-            {
-                (*dpdt)[i][j] = -signed_pow( (*q)[i][j] , KAPPA-1 ) 
-                    + coupling_lr + coupling_ud[j];
-                coupling_lr = signed_pow( (*q)[i][j]-(*q)[i][j+1] , LAMBDA-1 );
-                coupling_ud[j] = signed_pow( (*q)[i][j]-(*q)[i+1][j] , LAMBDA-1 );
-                (*dpdt)[i][j] -= coupling_lr + coupling_ud[j];
-            }
-            (*dpdt)[i][M-1] = -signed_pow( (*q)[i][M-1] , KAPPA-1 ) 
-                + coupling_lr + coupling_ud[M-1];
-            coupling_ud[M-1] = signed_pow( (*q)[i][M-1]-(*q)[i+1][M-1] , LAMBDA-1 );
-            coupling_lr = 0.0;
-            (*dpdt)[i][M-1] -= coupling_ud[M-1];
-        }
-        for( size_t j=0 ; j<M-1 ; ++j )
-        {
-            (*dpdt)[N-1][j] = -signed_pow( (*q)[N-1][j] , KAPPA-1 ) 
-                + coupling_lr + coupling_ud[j];
-            coupling_lr = signed_pow( (*q)[N-1][j]-(*q)[N-1][j+1] , LAMBDA-1 );
-            (*dpdt)[N-1][j] -= coupling_lr + signed_pow( (*q)[N-1][j] - q_d[j] , LAMBDA-1 );
-        }
-        (*dpdt)[N-1][M-1] = -signed_pow( (*q)[N-1][M-1] , KAPPA-1 ) 
-            + coupling_lr + coupling_ud[M-1]
-            - signed_pow( (*q)[N-1][M-1] - q_d[M-1] , LAMBDA-1 );
-    
-        //hpx::cout << (boost::format("first block done\n") ) << hpx::flush;
-        return dpdt;
-    }
+    halo_view( const shared_vecvec &tile , const double *data , 
+               const size_t stride , const size_t size )
+        : m_tile( tile ) , m_data( data ) , m_stride( stride ) , m_size( size )
+    { }
+
+    double operator[]( const size_t i ) const { return m_data[i*m_stride]; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    // contiguous values, only for rows
+    const double* data() const { return m_data; }
+
+private:
+    shared_vecvec m_tile;
+    const double *m_data;
+    size_t m_stride;
+    size_t m_size;
 };
 
+inline bool all_zero( const halo_view &h )
+{
+    for( size_t i=0 ; i<h.size() ; ++i )
+        if( h[i] != 0.0 )
+            return false;
+    return true;
+}
 
-struct system_center_block
+// a tile at rest with all halos at rest has zero force, dpdt is set to zero
+// and the evaluation is skipped
+inline bool skip_quiescent( const dvecvec &q , const halo_view &q_u , const halo_view &q_d , 
+                            const halo_view &q_l , const halo_view &q_r , dvecvec &dpdt )
 {
+    if( !( all_zero( q_u ) && all_zero( q_d ) && all_zero( q_l ) && all_zero( q_r ) 
+           && all_zero( q ) ) )
+        return false;
+    dpdt.fill( 0.0 );
+    return true;
+}
 
-    shared_vecvec operator() ( shared_vecvec q , const dvec q_u , 
-                               const dvec q_d , shared_vecvec dpdt ) const
-    {
-        //hpx::cout << (boost::format("center block\n") ) << hpx::flush;
- 
-        using checked_math::pow;
-        const size_t N = q->size();
-        const size_t M = (*q)[0].size();
+// force on one tile of the lattice. q_u and q_d are the rows above and below
+// the tile, q_l and q_r the columns left and right of it. halos at the
+// boundary of the lattice are empty.
+template< class Kappa , class Lambda >
+struct system_block
+{
+    const Kappa m_kappa;
+    const Lambda m_lambda;
 
-        double coupling_lr = 0.0;
-        dvec coupling_ud( M );
+    system_block( const Kappa kappa , const Lambda lambda )
+        : m_kappa( kappa ) , m_lambda( lambda )
+    { }
 
-        for( size_t j=0 ; j<M-1 ; ++j )
-        {
-            (*dpdt)[0][j] = -signed_pow( (*q)[0][j] , KAPPA-1 ) + coupling_lr
-                - signed_pow( (*q)[0][j] - q_u[j] , LAMBDA-1 );
-            coupling_lr = signed_pow( (*q)[0][j]-(*q)[0][j+1] , LAMBDA-1 );
-            coupling_ud[j] = signed_pow( (*q)[0][j]-(*q)[1][j] , LAMBDA-1 );
-            (*dpdt)[0][j] -= coupling_lr + coupling_ud[j];
-        }
-        (*dpdt)[0][M-1] = -signed_pow( (*q)[0][M-1] , KAPPA-1 ) + coupling_lr
-            - signed_pow( (*q)[0][M-1]-q_u[M-1] , LAMBDA-1 );
-        coupling_ud[M-1] = signed_pow( (*q)[0][M-1]-(*q)[1][M-1] , LAMBDA-1 );
-        coupling_lr = 0.0;
-        (*dpdt)[0][M-1] -= coupling_ud[M-1];
+    shared_vecvec operator()( shared_vecvec q_ , const halo_view q_u , const halo_view q_d , 
+                              const halo_view q_l , const halo_view q_r , shared_vecvec dpdt_ ) const
+    {
+        if( skip_quiescent( *q_ , q_u , q_d , q_l , q_r , *dpdt_ ) )
+            return dpdt_;
+
+        const dvecvec &q = *q_;
+        dvecvec &dpdt = *dpdt_;
+        const size_t N = q.size();
+        const size_t M = q.cols();
+        const typename Kappa::minus_one_type kap1 = m_kappa.minus_one();
+        const typename Lambda::minus_one_type lam1 = m_lambda.minus_one();
 
+        // vertical bonds to the row above
+        dvec coupling_ud( M , 0.0 );
+        if( !q_u.empty() )
+            for( size_t j=0 ; j<M ; ++j )
+                coupling_ud[j] = -lam1.signed_pow( q[0][j] - q_u[j] );
 
-        for( size_t i=1 ; i<N-1 ; ++i )
+        for( size_t i=0 ; i<N ; ++i )
         {
+            const double *q_i = q[i].data();
+            // the row below, none for the last row of the lattice
+            const double *q_n = ( i < N-1 ) ? q[i+1].data() : ( q_d.empty() ? 0 : q_d.data() );
+            double *dpdt_i = dpdt[i].data();
+            double coupling_lr = q_l.empty() ? 0.0 : -lam1.signed_pow( q_i[0] - q_l[i] );
             for( size_t j=0 ; j<M-1 ; ++j )
             {
-                (*dpdt)[i][j] = -signed_pow( (*q)[i][j] , KAPPA-1 ) 
-                    + coupling_lr + coupling_ud[j];
-                coupling_lr = signed_pow( (*q)[i][j]-(*q)[i][j+1] , LAMBDA-1 );
-                coupling_ud[j] = signed_pow( (*q)[i][j]-(*q)[i+1][j] , LAMBDA-1 );
-                (*dpdt)[i][j] -= coupling_lr + coupling_ud[j];
+                dpdt_i[j] = -kap1.signed_pow( q_i[j] ) + coupling_lr + coupling_ud[j];
+                coupling_lr = lam1.signed_pow( q_i[j]-q_i[j+1] );
+                coupling_ud[j] = ( q_n != 0 ) ? lam1.signed_pow( q_i[j]-q_n[j] ) : 0.0;
+                dpdt_i[j] -= coupling_lr + coupling_ud[j];
             }
-            (*dpdt)[i][M-1] = -signed_pow( (*q)[i][M-1] , KAPPA-1 ) 
-                + coupling_lr + coupling_ud[M-1];
-            coupling_ud[M-1] = signed_pow( (*q)[i][M-1]-(*q)[i+1][M-1] , LAMBDA-1 );
-            coupling_lr = 0.0;
-            (*dpdt)[i][M-1] -= coupling_ud[M-1];
+            dpdt_i[M-1] = -kap1.signed_pow( q_i[M-1] ) + coupling_lr + coupling_ud[M-1];
+            coupling_lr = q_r.empty() ? 0.0 : lam1.signed_pow( q_i[M-1]-q_r[i] );
+            coupling_ud[M-1] = ( q_n != 0 ) ? lam1.signed_pow( q_i[M-1]-q_n[M-1] ) : 0.0;
+            dpdt_i[M-1] -= coupling_lr + coupling_ud[M-1];
         }
-
-        for( size_t j=0 ; j<M-1 ; ++j )
-        {
-            (*dpdt)[N-1][j] = -signed_pow( (*q)[N-1][j] , KAPPA-1 ) 
-                + coupling_lr + coupling_ud[j];
-            coupling_lr = signed_pow( (*q)[N-1][j]-(*q)[N-1][j+1] , LAMBDA-1 );
-            (*dpdt)[N-1][j] -= coupling_lr + signed_pow( (*q)[N-1][j] - q_d[j] , LAMBDA-1 );
-        }
-        (*dpdt)[N-1][M-1] = -signed_pow( (*q)[N-1][M-1] , KAPPA-1 ) 
-            + coupling_lr + coupling_ud[M-1]
-            - signed_pow( (*q)[N-1][M-1] - q_d[M-1] , LAMBDA-1 );
-    
-        //hpx::cout << (boost::format("center block done\n") ) << hpx::flush;
-
-        return dpdt;
+        return dpdt_;
     }
 };
 
-
-struct system_last_block
+// views of the outer rows and columns of a tile, the halos of its neighbors
+struct first_row
 {
-
-    typedef shared_vec result_type;
-
-    shared_vecvec operator()( shared_vecvec q , const dvec q_u , shared_vecvec dpdt ) const
+    halo_view operator()( shared_vecvec v ) const
     {
-        //hpx::cout << (boost::format("last block\n") ) << hpx::flush;
-
-        using checked_math::pow;
-        const size_t N = q->size();
-        const size_t M = (*q)[0].size();
+        return halo_view( v , (*v)[0].data() , 1 , v->cols() );
+    }
+};
 
-        double coupling_lr = 0.0;
-        dvec coupling_ud( M );
+struct last_row
+{
+    halo_view operator()( shared_vecvec v ) const
+    {
+        return halo_view( v , (*v)[v->size()-1].data() , 1 , v->cols() );
+    }
+};
 
-        //hpx::cout << (boost::format("last block iterating...\n") ) << hpx::flush;
+struct first_column
+{
+    halo_view operator()( shared_vecvec v ) const
+    {
+        return halo_view( v , v->data() , v->stride() , v->size() );
+    }
+};
 
-        for( size_t j=0 ; j<M-1 ; ++j )
-        {
-            (*dpdt)[0][j] = -signed_pow( (*q)[0][j] , KAPPA-1 ) + coupling_lr
-                - signed_pow( (*q)[0][j] - q_u[j] , LAMBDA-1 );
-            coupling_lr = signed_pow( (*q)[0][j]-(*q)[0][j+1] , LAMBDA-1 );
-            coupling_ud[j] = signed_pow( (*q)[0][j]-(*q)[1][j] , LAMBDA-1 );
-            (*dpdt)[0][j] -= coupling_lr + coupling_ud[j];
-        }
-        (*dpdt)[0][M-1] = -signed_pow( (*q)[0][M-1] , KAPPA-1 ) + coupling_lr
-            - signed_pow( (*q)[0][M-1]-q_u[M-1] , LAMBDA-1 );
-        coupling_ud[M-1] = signed_pow( (*q)[0][M-1]-(*q)[1][M-1] , LAMBDA-1 );
-        coupling_lr = 0.0;
-        (*dpdt)[0][M-1] -= coupling_ud[M-1];
+struct last_column
+{
+    halo_view operator()( shared_vecvec v ) const
+    {
+        return halo_view( v , v->data() + v->cols()-1 , v->stride() , v->size() );
+    }
+};
 
-        for( size_t i=1 ; i<N-1 ; ++i )
-        {
-            //hpx::cout << (boost::format("row %d\n") % i ) << hpx::flush;
-            for( size_t j=0 ; j<M-1 ; ++j )
-            {
-                //hpx::cout << (boost::format("row %d , col %d \n") % i %j ) << hpx::flush;
-                (*dpdt)[i][j] = -signed_pow( (*q)[i][j] , KAPPA-1 ) 
-                    + coupling_lr + coupling_ud[j];
-                coupling_lr = signed_pow( (*q)[i][j]-(*q)[i][j+1] , LAMBDA-1 );
-                coupling_ud[j] = signed_pow( (*q)[i][j]-(*q)[i+1][j] , LAMBDA-1 );
-                (*dpdt)[i][j] -= coupling_lr + coupling_ud[j];
-            }
-            //hpx::cout << (boost::format("row %d , col %d \n") % i % (M-1) ) << hpx::flush;
-            (*dpdt)[i][M-1] = -signed_pow( (*q)[i][M-1] , KAPPA-1 ) 
-                + coupling_lr + coupling_ud[M-1];
-            coupling_ud[M-1] = signed_pow( (*q)[i][M-1]-(*q)[i+1][M-1] , LAMBDA-1 );
-            coupling_lr = 0.0;
-            (*dpdt)[i][M-1] -= coupling_ud[M-1];
-        }
+// interior part of the split rhs of a tile: needs only the tile itself. it
+// is evaluated without halos, the bonds to the neighbors are added later by
+// bind_tile_halos.
+template< class Kappa , class Lambda >
+struct interior_tile
+{
+    const system_block< Kappa , Lambda > m_block;
 
-        for( size_t j=0 ; j<M-1 ; ++j )
-        {
-            (*dpdt)[N-1][j] = -signed_pow( (*q)[N-1][j] , KAPPA-1 ) 
-                + coupling_lr + coupling_ud[j];
-            coupling_lr = signed_pow( (*q)[N-1][j]-(*q)[N-1][j+1] , LAMBDA-1 );
-            (*dpdt)[N-1][j] -= coupling_lr;
-        }
-        (*dpdt)[N-1][M-1] = -signed_pow( (*q)[N-1][M-1] , KAPPA-1 ) 
-            + coupling_lr + coupling_ud[M-1];
-    
-        //hpx::cout << (boost::format("last block done\n") ) << hpx::flush;
+    interior_tile( const system_block< Kappa , Lambda > &block )
+        : m_block( block )
+    { }
 
-        return dpdt;
+    shared_vecvec operator()( shared_vecvec q , shared_vecvec dpdt ) const
+    {
+        return m_block( q , halo_view() , halo_view() , halo_view() , halo_view() , dpdt );
     }
 };
 
-void system_2d( state_type &q , state_type &dpdt )
+// forces of the bonds of one outer row or column of a tile, given by View,
+// to the halo h of the neighbor. an edge task of the split rhs.
+template< class Lambda , class View >
+struct edge_bonds
 {
-    // works on shared data, but coupling data is provided as copy
-    const size_t N = q.size();
+    const Lambda m_lambda;
 
-    //hpx::cout << boost::format("system call size: %d , %d ...\n") % (q.size()) % (dpdt.size()) << hpx::flush;
+    edge_bonds( const Lambda lambda ) : m_lambda( lambda ) { }
 
-    //state_type dpdt_(N);
-    // first row
-    dpdt[0] = dataflow( hpx::launch::async , unwrapped(system_first_block()) , q[0] , 
-                        dataflow( hpx::launch::sync , unwrapped([](shared_vecvec v) 
-        { return (*v)[0]; }) , q[1] ) , 
-                        dpdt[0] );
-    // middle rows
-    for( size_t i=1 ; i<N-1 ; i++ )
+    shared_row operator()( shared_vecvec q , const halo_view h ) const
     {
-        dpdt[i] = dataflow( hpx::launch::async , unwrapped(system_center_block()) , q[i] , 
-                            dataflow( hpx::launch::sync , unwrapped([](shared_vecvec v) 
-            { return (*v)[v->size()-1]; }) ,
-                                      q[i-1] ) , 
-                            dataflow( hpx::launch::sync , unwrapped([](shared_vecvec v) 
-            { return (*v)[0]; }) , q[i+1] ) ,
-                            dpdt[i] );
+        const typename Lambda::minus_one_type lam1 = m_lambda.minus_one();
+        const halo_view edge = View()( q );
+        shared_row f = block_pool< dvec >::instance().acquire();
+        f->resize( h.size() );
+        for( size_t i=0 ; i<h.size() ; ++i )
+            (*f)[i] = lam1.signed_pow( h[i] - edge[i] );
+        return f;
     }
-    dpdt[N-1] = dataflow( hpx::launch::async , unwrapped(system_last_block()) , q[N-1] , 
-                          dataflow( hpx::launch::sync , unwrapped([](shared_vecvec v) 
-        { return (*v)[v->size()-1]; }), 
-                                    q[N-2] ) , 
-                          dpdt[N-1] );
-
-    /*
-    // synchronization to make sure q doesn't get changed while dpdt isn't ready
-    for( size_t i=1 ; i<N-1 ; i++ )
+};
+
+// adds the bonds to the neighbors to the interior forces, null at the
+// boundary of the lattice
+struct bind_tile_halos
+{
+    shared_vecvec operator()( shared_vecvec dpdt_ , shared_row f_u , shared_row f_d , 
+                              shared_row f_l , shared_row f_r ) const
     {
-        q[i] = dataflow( hpx::launch::async , 
-                         unwrap([]( shared_vec x , shared_vec sync){ return x; } ) ,
-                         q[i] , 
-                         dpdt[i] );
+        dvecvec &dpdt = *dpdt_;
+        const size_t N = dpdt.size();
+        const size_t M = dpdt.cols();
+        for( size_t j=0 ; f_u && j<M ; ++j )
+            dpdt[0][j] += (*f_u)[j];
+        for( size_t j=0 ; f_d && j<M ; ++j )
+            dpdt[N-1][j] += (*f_d)[j];
+        for( size_t i=0 ; f_l && i<N ; ++i )
+            dpdt[i][0] += (*f_l)[i];
+        for( size_t i=0 ; f_r && i<N ; ++i )
+            dpdt[i][M-1] += (*f_r)[i];
+        return dpdt_;
     }
-    */
+};
+
+// halo view of tile n, empty at the boundary of the lattice
+template< class S , class View >
+future< halo_view > halo( S &q , const bool exists , const size_t n , const View view ,
+                          const task_executor &executor )
+{
+    if( exists )
+        return executor.sync( unwrapped( view ) , q[n] );
+    else
+        return make_ready_future( halo_view() );
 }
 
-void system_2d_gb( state_type &q , state_type &dpdt )
+// edge task of the outer row or column View of tile n with the halo of its
+// neighbor, null at the boundary of the lattice
+template< class View , class Lambda , class S , class Halo >
+future< shared_row > edge( S &q , const size_t n , const Lambda lambda , 
+                           const bool exists , const size_t neighbor , const Halo halo_of ,
+                           const task_executor &executor )
 {
-    // works on shared data, but coupling data is provided as copy
-    const size_t N = q.size();
+    if( !exists )
+        return make_ready_future( shared_row() );
+    return executor( halo_task , unwrapped( edge_bonds< Lambda , View >( lambda ) ) , q[n] , 
+                     halo( q , true , neighbor , halo_of , executor ) );
+}
 
-    // first row
-    dpdt[0] = dataflow( hpx::launch::async , unwrapped(system_first_block()) , q[0] , 
-                        dataflow( hpx::launch::sync , unwrapped([](shared_vecvec v) 
-        { return (*v)[0]; }) , q[1] ) , 
-                        dpdt[0] );
-    // middle rows
-    for( size_t i=1 ; i<N-1 ; i++ )
+// the lattice is split into tiles of Gx rows and Gy columns, stored row by
+// row of tiles: tile (I,J) is q[I*Mx+J] with Mx tiles per row of the
+// lattice. Mx=1 gives stripes of full rows. with split the interior of a
+// tile starts as soon as the tile is ready and the bonds to its neighbors
+// are up to four separate edge tasks. the tasks, halo views and bindings
+// are made by the executor, see task_executor.hpp
+template< class Kappa = real_exponent , class Lambda = real_exponent >
+struct system_2d
+{
+    const Kappa m_kappa;
+    const Lambda m_lambda;
+    const size_t m_Mx;
+    const bool m_split;
+    const task_executor m_executor;
+
+    system_2d( const Kappa kappa = KAPPA , const Lambda lambda = LAMBDA , const size_t Mx = 1 ,
+               const bool split = false ,
+               const task_executor &executor = task_executor::instance() )
+        : m_kappa( kappa ) , m_lambda( lambda ) , m_Mx( Mx ) , m_split( split ) ,
+          m_executor( executor )
+    { }
+
+    void operator()( state_type &q , state_type &dpdt ) const
     {
-        dpdt[i] = dataflow( hpx::launch::async , unwrapped(system_center_block()) , q[i] , 
-                            dataflow( hpx::launch::sync , unwrapped([](shared_vecvec v) 
-            { return (*v)[v->size()-1]; }) ,
-                                      q[i-1] ) , 
-                            dataflow( hpx::launch::sync , unwrapped([](shared_vecvec v) 
-            { return (*v)[0]; }) , q[i+1] ) ,
-                            dpdt[i] );
+        // works on shared data, but coupling data is provided as copy
+        const size_t My = q.size() / m_Mx;
+        const system_block< Kappa , Lambda > block( m_kappa , m_lambda );
+
+        for( size_t I=0 ; I<My ; ++I )
+            for( size_t J=0 ; J<m_Mx ; ++J )
+            {
+                const size_t n = I*m_Mx + J;
+                if( !m_split )
+                {
+                    dpdt[n] = m_executor( bulk_task , unwrapped( block ) , q[n] , 
+                                          halo( q , I > 0 , n-m_Mx , last_row() , m_executor ) , 
+                                          halo( q , I < My-1 , n+m_Mx , first_row() , m_executor ) , 
+                                          halo( q , J > 0 , n-1 , last_column() , m_executor ) , 
+                                          halo( q , J < m_Mx-1 , n+1 , first_column() , m_executor ) , 
+                                          dpdt[n] );
+                    continue;
+                }
+                // the interior starts as soon as the tile is ready, the bonds
+                // to the neighbors are bound when their halos arrive
+                const future< shared_vecvec > d = 
+                    m_executor( bulk_task , unwrapped( interior_tile< Kappa , Lambda >( block ) ) , q[n] , dpdt[n] );
+                dpdt[n] = m_executor.sync( unwrapped( bind_tile_halos() ) , d , 
+                                           edge< first_row >( q , n , m_lambda , I > 0 , n-m_Mx , last_row() , m_executor ) , 
+                                           edge< last_row >( q , n , m_lambda , I < My-1 , n+m_Mx , first_row() , m_executor ) , 
+                                           edge< first_column >( q , n , m_lambda , J > 0 , n-1 , last_column() , m_executor ) , 
+                                           edge< last_column >( q , n , m_lambda , J < m_Mx-1 , n+1 , first_column() , m_executor ) );
+            }
+        m_executor.stage( dpdt );
     }
-    dpdt[N-1] = dataflow( hpx::launch::async , unwrapped(system_last_block()) , q[N-1] , 
-                          dataflow( hpx::launch::sync , unwrapped([](shared_vecvec v) 
-        { return (*v)[v->size()-1]; }), 
-                                    q[N-2] ) , 
-                          dpdt[N-1] );
-    // global barrier
-    wait( dpdt );
+};
 
-}
+template< class Kappa = real_exponent , class Lambda = real_exponent >
+struct system_2d_gb : system_2d< Kappa , Lambda >
+{
+    system_2d_gb( const Kappa kappa = KAPPA , const Lambda lambda = LAMBDA , const size_t Mx = 1 ,
+                  const bool split = false )
+        : system_2d< Kappa , Lambda >( kappa , lambda , Mx , split )
+    { }
 
+    void operator()( state_type &q , state_type &dpdt ) const
+    {
+        system_2d< Kappa , Lambda >::operator()( q , dpdt );
+        // global barrier
+        wait( dpdt );
+    }
+};
 
-double energy( const dvecvec &q , const dvecvec &p )
+template< class Kappa , class Lambda >
+double energy( const dvecvec &q , const dvecvec &p , const Kappa kappa , const Lambda lambda )
 {
-    using checked_math::pow;
-    using std::abs;
+    const double K = kappa.value();
+    const double L = lambda.value();
     const size_t N = q.size();
     double energy = 0.0;
     for( size_t i=0 ; i<N-1 ; ++i )
@@ -309,36 +352,101 @@ double energy( const dvecvec &q , const dvecvec &p )
         const size_t M = q[i].size();
         for( size_t j=0 ; j<M-1 ; ++j )
         {
-            energy += 0.5*p[i][j]*p[i][j] + pow( q[i][j] , KAPPA ) / KAPPA
-                + pow( abs(q[i][j]-q[i][j+1]) , LAMBDA ) / LAMBDA
-                + pow( abs(q[i][j]-q[i+1][j]) , LAMBDA ) / LAMBDA;
+            energy += 0.5*p[i][j]*p[i][j] + kappa.pow( q[i][j] ) / K
+                + lambda.pow( q[i][j]-q[i][j+1] ) / L
+                + lambda.pow( q[i][j]-q[i+1][j] ) / L;
         }
-        energy += 0.5*p[i][M-1]*p[i][M-1] + pow( q[i][M-1] , KAPPA ) / KAPPA
-            + pow( abs(q[i][M-1]-q[i+1][M-1]) , LAMBDA ) / LAMBDA;
+        energy += 0.5*p[i][M-1]*p[i][M-1] + kappa.pow( q[i][M-1] ) / K
+            + lambda.pow( q[i][M-1]-q[i+1][M-1] ) / L;
     }
     const size_t M = q[N-1].size();
     for( size_t j=0 ; j<M-1 ; ++j )
     {
-        energy += 0.5*p[N-1][j]*p[N-1][j] + pow( q[N-1][j] , KAPPA ) / KAPPA
-            + pow( abs(q[N-1][j]-q[N-1][j+1]) , LAMBDA ) / LAMBDA;
+        energy += 0.5*p[N-1][j]*p[N-1][j] + kappa.pow( q[N-1][j] ) / K
+            + lambda.pow( q[N-1][j]-q[N-1][j+1] ) / L;
     }
-    energy += 0.5*p[N-1][M-1]*p[N-1][M-1] + pow( q[N-1][M-1] , KAPPA ) / KAPPA;
+    energy += 0.5*p[N-1][M-1]*p[N-1][M-1] + kappa.pow( q[N-1][M-1] ) / K;
     return energy;
 }
 
-template< typename S >
-double energy( const S &q_fut , const S &p_fut )
+// energy of one tile including the bonds to the row below and the column
+// right of it, these halos are empty at the boundary of the lattice
+template< class Kappa , class Lambda >
+struct block_energy
 {
-    dvecvec q,p;
-    for( size_t i=0 ; i<q_fut.size() ; ++i )
+    const Kappa m_kappa;
+    const Lambda m_lambda;
+
+    block_energy( const Kappa kappa , const Lambda lambda )
+        : m_kappa( kappa ) , m_lambda( lambda )
+    { }
+
+    double operator()( shared_vecvec q_ , shared_vecvec p_ , const halo_view q_d , const halo_view q_r ) const
     {
-        for( size_t j=0 ; j<(*(q_fut[i].get())).size() ; ++j )
+        const dvecvec &q = *q_;
+        const dvecvec &p = *p_;
+        const double K = m_kappa.value();
+        const double L = m_lambda.value();
+        const size_t N = q.size();
+        const size_t M = q.cols();
+        double energy = 0.0;
+        for( size_t i=0 ; i<N ; ++i )
         {
-            q.push_back( (*(q_fut[i].get()))[j] );
-            p.push_back( (*(p_fut[i].get()))[j] );
+            // the row below, none for the last row of the lattice
+            const double *d = ( i < N-1 ) ? q[i+1].data() : ( q_d.empty() ? 0 : q_d.data() );
+            for( size_t j=0 ; j<M-1 ; ++j )
+            {
+                energy += 0.5*p[i][j]*p[i][j] + m_kappa.pow( q[i][j] ) / K
+                    + m_lambda.pow( q[i][j]-q[i][j+1] ) / L;
+                if( d != 0 )
+                    energy += m_lambda.pow( q[i][j]-d[j] ) / L;
+            }
+            energy += 0.5*p[i][M-1]*p[i][M-1] + m_kappa.pow( q[i][M-1] ) / K;
+            if( !q_r.empty() )
+                energy += m_lambda.pow( q[i][M-1]-q_r[i] ) / L;
+            if( d != 0 )
+                energy += m_lambda.pow( q[i][M-1]-d[M-1] ) / L;
         }
+        return energy;
     }
-    return energy( q , p );
+};
+
+// passes x on after the energy task reading it is finished
+struct energy_fence
+{
+    shared_vecvec operator()( shared_vecvec x , const double ) const
+    {
+        return x;
+    }
+};
+
+// asynchronous energy: one task per tile, summed in a tree. the energy tasks
+// read versions of q, p is fenced by the tile energies so that the later
+// in-place update waits for them.
+// Mx is the number of tiles per row of the lattice.
+template< typename S , class Kappa , class Lambda >
+future< double > energy( S &q , S &p , const Kappa kappa , const Lambda lambda , 
+                         const size_t Mx = 1 ,
+                         const task_executor &executor = task_executor::instance() )
+{
+    const size_t N = q.size();
+    const size_t My = N / Mx;
+    const block_energy< Kappa , Lambda > block( kappa , lambda );
+    std::vector< future< double > > e( N );
+    for( size_t n=0 ; n<N ; ++n )
+        e[n] = executor( bulk_task , unwrapped( block ) , q[n] , p[n] , 
+                         halo( q , n/Mx < My-1 , n+Mx , first_row() , executor ) , 
+                         halo( q , n%Mx < Mx-1 , n+1 , first_column() , executor ) );
+    const future< double > total = tree_sum( e );
+    for( size_t n=0 ; n<N ; ++n )
+        p[n] = executor.sync( unwrapped( energy_fence() ) , p[n] , e[n] );
+    return total;
+}
+
+template< typename S >
+future< double > energy( S &q , S &p , const size_t Mx = 1 )
+{
+    return energy( q , p , real_exponent( KAPPA ) , real_exponent( LAMBDA ) , Mx );
 }
 
 #endif
@@ -2,11 +2,20 @@
 #define INITIALIZE_HPP
 
 #include <memory>
+#include <vector>
+#include <algorithm>
 
-typedef std::vector< double > dvec;
-typedef std::vector< dvec > dvecvec;
+#include "../../common/block_pool.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/tile.hpp"
+
+typedef aligned_dvec dvec;
+typedef tile dvecvec;
 typedef std::shared_ptr< dvecvec > shared_vec;
 
+// the initializers return a block from the pool, v is only a placeholder
+// that orders the initialization
+
 struct initialize_zero
 {
     const size_t m_N1;
@@ -16,41 +25,49 @@ struct initialize_zero
         : m_N1( N1 ) , m_N2( N2 )
     { }
 
-    shared_vec operator()( shared_vec v ) const
+    shared_vec operator()( shared_vec ) const
     {
+        shared_vec v = block_pool< dvecvec >::instance().acquire();
         //hpx::cout << "initializing vector with zero ...\n" << hpx::flush;
-        v->resize( m_N1 );
-        for( size_t n=0 ; n<m_N1 ; ++n )
-        {
-            (*v)[n].resize( m_N2 );
-            std::fill( (*v)[n].begin() , (*v)[n].end() , 0.0 );
-        }
+        v->resize( m_N1 , m_N2 );
+        v->fill( 0.0 );
         //hpx::cout << "initializing vector with zero finished\n" << hpx::flush;
         return v;
     }
 };
 
 
+// copies len rows starting at index, and width columns starting at col, of
+// the full lattice data into a tile
 struct initialize_copy
 {
     const dvecvec &m_data; // why no reference here?
     const size_t m_index;
     const size_t m_len;
+    const size_t m_col;
+    const size_t m_width;
 
     initialize_copy( const dvecvec &data , const size_t index , const size_t len )
-        : m_data( data ) , m_index( index ) , m_len( len )
+        : m_data( data ) , m_index( index ) , m_len( len ) , 
+          m_col( 0 ) , m_width( data.cols() )
+    { }
+
+    initialize_copy( const dvecvec &data , const size_t index , const size_t len , 
+                     const size_t col , const size_t width )
+        : m_data( data ) , m_index( index ) , m_len( len ) , 
+          m_col( col ) , m_width( width )
     { }
 
-    shared_vec operator()( shared_vec v ) const
+    shared_vec operator()( shared_vec ) const
     {
+        shared_vec v = block_pool< dvecvec >::instance().acquire();
         //hpx::cout << boost::format("initializing vector from data at index %d ...\n") % m_index << hpx::flush;
-        v->resize( m_len );
+        v->resize( m_len , m_width );
         for( size_t n=0 ; n<m_len ; ++n )
         {
-            //hpx::cout << boost::format("resizing sub vector %d of %d to size %d ...\n") % n % m_len % (m_data[m_index+n].size()) << hpx::flush;
-            (*v)[n].resize( m_data[m_index+n].size() );
             //hpx::cout << boost::format("copying data %d of %d ...\n") % n % m_len << hpx::flush;
-            std::copy( m_data[m_index+n].begin() , m_data[m_index+n].end() , (*v)[n].begin() );
+            const double *row = m_data[m_index+n].data() + m_col;
+            std::copy( row , row + m_width , (*v)[n].begin() );
         }
         //hpx::cout << "initializing vector from data finished\n" << hpx::flush;
         return v;
@@ -5,6 +5,10 @@
 #include <hpx/lcos/local/dataflow.hpp>
 #include <hpx/util/unwrapped.hpp>
 
+#include "../../common/task_priority.hpp"
+#include "../../common/block_pool.hpp"
+#include "../../common/quiescence.hpp"
+
 using hpx::lcos::local::dataflow;
 using hpx::lcos::future;
 using hpx::util::unwrapped;
@@ -13,16 +17,56 @@ struct local_dataflow_algebra
 {
 
     //template< class S1 , class S2 , class S3 , class Op >
-    // for now just a single state  type
+    // for now just a single state  type. the updates are of class c, the
+    // caller knows if the neighbors wait for s1
     template< typename S , typename Op >
-    void for_each3( S &s1 , const S &s2 , const S &s3 , Op op )
+    void for_each3( const task_class c , S &s1 , const S &s2 , const S &s3 , Op op )
     {
         const size_t N = boost::size( s1 );
         for( size_t i=0 ; i<N ; ++i )
-        {
-            s1[i] = dataflow( hpx::launch::sync , unwrapped(op) , s1[i] , s2[i] , s3[i] );
-        }
+            s1[i] = spawn( c , unwrapped(op) , s1[i] , s2[i] , s3[i] );
+    }
+
+    // momentum updates, in place. odeint's stepper uses the same call for
+    // the coordinates, which the halo views of the rhs read in place, so the
+    // 2d system is integrated with two_pass_symplectic_stepper
+    template< typename S , typename Op >
+    void for_each3( S &s1 , const S &s2 , const S &s3 , Op op )
+    {
+        for_each3( update_task , s1 , s2 , s3 , op );
+    }
+};
+
+// the coordinate update writes a new version of the tile into a tile of the
+// block pool instead of updating it in place. the halo views of the rhs
+// tasks hold the tile of the version they read, it stays valid until the
+// last of them is finished and goes back to the pool then.
+template< class Op >
+struct next_version
+{
+    const Op m_op;
+
+    next_version( const Op op )
+        : m_op( op )
+    { }
+
+    template< typename S1 , typename S2 , typename S3 >
+    S1 operator()( S1 x1 , const S2 x2 , const S3 x3 ) const
+    {
+        // a zero increment keeps the version
+        if( m_op.m_alpha1 == 1 && x1 == x2 && all_zero( *x3 ) )
+            return x1;
+        S1 y = block_pool< typename S1::element_type >::instance().acquire();
+        y->resize( x1->size() , x1->cols() );
+        return m_op( y , x2 , x3 );
     }
 };
 
+// the coordinate stage of the two pass stepper, the neighbors wait for it
+template< typename S , typename Op >
+void for_each3_coordinates( local_dataflow_algebra &algebra , S &s1 , const S &s2 , const S &s3 , Op op )
+{
+    algebra.for_each3( halo_task , s1 , s2 , s3 , next_version< Op >( op ) );
+}
+
 #endif
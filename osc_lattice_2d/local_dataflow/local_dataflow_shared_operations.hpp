@@ -7,8 +7,12 @@
 
 #include <boost/utility/result_of.hpp>
 
-typedef std::vector< double > dvec;
-typedef std::vector< dvec > dvecvec;
+#include "../../common/quiescence.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/tile.hpp"
+
+typedef aligned_dvec dvec;
+typedef tile dvecvec;
 typedef std::shared_ptr< dvecvec > shared_vec;
 
 struct local_dataflow_shared_operations2d
@@ -31,9 +35,16 @@ struct local_dataflow_shared_operations2d
         S1 operator() ( S1 x1 , const S2 x2 , const S3 x3 ) const
         {
             //hpx::cout << boost::format( "operation sizes: %d , %d ; %d , %d ; %d , %d\n") % (x1->size()) % (*x1)[0].size() % (x2->size()) % (*x2)[0].size() % (x3->size()) % (*x3)[0].size() << hpx::flush;
-            for( size_t i=0 ; i<x1->size() ; ++i )
-                for( size_t j=0 ; j<(*x1)[i].size() ; ++j )
-                    (*x1)[i][j] = m_alpha1*(*x2)[i][j] + m_alpha2*(*x3)[i][j];
+            // in-place update with a zero increment, nothing to do
+            if( m_alpha1 == 1 && x1 == x2 && all_zero( *x3 ) )
+                return x1;
+            // all tiles have the same shape, the padding is updated as well
+            const size_t N = x1->size()*x1->stride();
+            double *y = x1->data();
+            const double *a = x2->data();
+            const double *b = x3->data();
+            for( size_t n=0 ; n<N ; ++n )
+                y[n] = m_alpha1*a[n] + m_alpha2*b[n];
             //hpx::cout << boost::format( "operation finished\n" ) << hpx::flush;
             return x1;
         }
@@ -22,6 +22,12 @@
 #include "local_dataflow_shared_operations.hpp"
 #include "initialize.hpp"
 #include "2d_system.hpp"
+#include "reblock.hpp"
+#include "../../common/granularity_tuner.hpp"
+#include "../../common/task_priority.hpp"
+#include "../../common/two_pass_symplectic_stepper.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/tile.hpp"
 
 using hpx::lcos::future;
 using hpx::find_here;
@@ -34,8 +40,8 @@ using hpx::util::unwrapped;
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 using boost::numeric::odeint::integrate_n_steps;
 
-typedef std::vector< double > dvec;
-typedef std::vector< dvec > dvecvec;
+typedef aligned_dvec dvec;
+typedef tile dvecvec;
 typedef std::shared_ptr< dvecvec > shared_vec;
 typedef std::vector< future< shared_vec > > state_type;
 
@@ -46,7 +52,125 @@ typedef symplectic_rkn_sb3a_mclachlan< state_type ,
                                        state_type , 
                                        double ,
                                        local_dataflow_algebra ,
-                                       local_dataflow_shared_operations2d > stepper_type;
+                                       local_dataflow_shared_operations2d > odeint_stepper_type;
+
+// the coordinate updates are halo tasks
+typedef two_pass_symplectic_stepper< odeint_stepper_type > stepper_type;
+
+struct perf_run
+{
+    const std::size_t N1;
+    const std::size_t N2;
+    const std::size_t G;
+    // columns per tile
+    const std::size_t Gy;
+    const bool fully_random;
+    const std::size_t init_length;
+    const std::size_t steps;
+    const double dt;
+    const std::size_t tune_steps;
+    const bool split_rhs;
+
+    double avrg_time;
+    double min_time;
+    // rows per block after tuning
+    std::size_t G_tuned;
+
+    perf_run( const std::size_t N1_ , const std::size_t N2_ , const std::size_t G_ ,
+              const std::size_t Gy_ , const bool fully_random_ , const std::size_t init_length_ ,
+              const std::size_t steps_ , const double dt_ , const std::size_t tune_steps_ ,
+              const bool split_rhs_ )
+        : N1( N1_ ) , N2( N2_ ) , G( G_ ) , Gy( Gy_ ) , 
+          fully_random( fully_random_ ) , init_length( init_length_ ) ,
+          steps( steps_ ) , dt( dt_ ) , tune_steps( tune_steps_ ) , split_rhs( split_rhs_ ) ,
+          avrg_time( 0.0 ) , min_time( 1000000.0 ) , G_tuned( G_ )
+    { }
+
+    template< class Kappa , class Lambda >
+    void operator()( const Kappa kappa , const Lambda lambda )
+    {
+        // tiles per row and total number of tiles
+        const std::size_t Mx = N2/Gy;
+        const std::size_t M = (N1/G)*Mx;
+
+        for( size_t n=0 ; n<12 ; ++n )
+        {
+
+            dvecvec p_init( N1 , N2 , 0.0 );
+
+            std::uniform_real_distribution<double> distribution( -1.0 , 1.0 );
+            std::mt19937 engine( 0 ); // Mersenne twister MT19937
+            auto generator = std::bind(distribution, engine);
+
+            if( fully_random )
+            {
+                for( size_t j=0 ; j<N1 ; j++ )
+                    std::generate( p_init[j].begin() , 
+                                   p_init[j].end() , 
+                                   std::ref(generator) );
+            } else
+            {
+                for( size_t j=N1/2-init_length/2 ; j<N1/2+init_length/2 ; j++ )
+                    std::generate( p_init[j].begin()+N2/2-init_length/2 , 
+                                   p_init[j].begin()+N2/2+init_length/2 , 
+                                   std::ref(generator) );
+            }
+
+            state_type q( M );
+            state_type p( M );
+
+            for( size_t i=0 ; i<M ; ++i )
+            {
+                q[i] = make_ready_future( std::allocate_shared<dvecvec>( std::allocator<dvecvec>() ) );
+                q[i] = dataflow( hpx::launch::async ,
+                                 unwrapped(initialize_zero( G , Gy )) , q[i] );
+                p[i] = make_ready_future( std::allocate_shared<dvecvec>( std::allocator<dvecvec>() ) );
+                p[i] = dataflow( hpx::launch::async ,
+                                 unwrapped(initialize_copy( p_init , (i/Mx)*G , G , (i%Mx)*Gy , Gy )) , p[i] );
+            }
+
+            wait( q );
+            wait( p );
+
+            hpx::util::high_resolution_timer timer;
+
+            // the tuning trials are the first steps of the run,
+            // the system needs at least two blocks of two rows,
+            // re-blocking only works for full rows
+            size_t steps_left = steps;
+            if( tune_steps > 0 && Mx == 1 )
+            {
+                reblock_trial< stepper_type , system_2d< Kappa , Lambda > , state_type , reblocking >
+                    trial( q , p , system_2d< Kappa , Lambda >( kappa , lambda , 1 , split_rhs ) , dt , tune_steps , steps );
+                G_tuned = tune_granularity( trial , N1 , G , 2 ,
+                                            std::min( N1/2 , N1/hpx::get_os_thread_count() ) );
+                reblock( q , G_tuned );
+                reblock( p , G_tuned );
+                steps_left -= std::min( steps_left , trial.m_steps_done );
+            }
+
+            integrate_n_steps( stepper_type() , system_2d< Kappa , Lambda >( kappa , lambda , Mx , split_rhs ) , 
+                               std::make_pair( boost::ref(q) , boost::ref(p) ) ,
+                               0.0 , dt , steps_left );
+
+            //hpx::cout << "dataflow generation ready\n" << hpx::flush;
+
+            wait( q );
+            wait( p );
+
+            double run_time = timer.elapsed();
+
+            if( n > 1 )
+            {
+                avrg_time += run_time;
+                min_time = std::min( run_time , min_time );
+            }
+
+            std::clog << G_tuned << ", run: " << n << " run time: " << run_time << std::endl;
+
+        }
+    }
+};
 
 int hpx_main(boost::program_options::variables_map& vm)
 {
@@ -54,83 +178,29 @@ int hpx_main(boost::program_options::variables_map& vm)
     const std::size_t N1 = vm["N1"].as<std::size_t>();
     const std::size_t N2 = vm["N2"].as<std::size_t>();
     const std::size_t G = vm["G"].as<std::size_t>();
+    const std::size_t Gy = ( vm["Gy"].as<std::size_t>() > 0 ) ? vm["Gy"].as<std::size_t>() : N2;
     const bool fully_random = vm["fully_random"].as<bool>();
     const std::size_t init_length = vm["init_length"].as<std::size_t>();
     const std::size_t steps = vm["steps"].as<std::size_t>();
     const double dt = vm["dt"].as<double>();
+    const double kappa = vm["kappa"].as<double>();
+    const double lambda = vm["lambda"].as<double>();
+    const std::size_t tune_steps = vm["tune_steps"].as<std::size_t>();
 
-    const std::size_t M = N1/G;
-    double avrg_time = 0.0;
-    double min_time = 1000000.0;
-
-    for( size_t n=0 ; n<12 ; ++n )
-    {
-
-        dvecvec p_init( N1 , dvec( N2 , 0.0 ) );
-
-        std::uniform_real_distribution<double> distribution( -1.0 , 1.0 );
-        std::mt19937 engine( 0 ); // Mersenne twister MT19937
-        auto generator = std::bind(distribution, engine);
-
-        if( fully_random )
-        {
-            for( size_t j=0 ; j<N1 ; j++ )
-                std::generate( p_init[j].begin() , 
-                               p_init[j].end() , 
-                               std::ref(generator) );
-        } else
-        {
-            for( size_t j=N1/2-init_length/2 ; j<N1/2+init_length/2 ; j++ )
-                std::generate( p_init[j].begin()+N2/2-init_length/2 , 
-                               p_init[j].begin()+N2/2+init_length/2 , 
-                               std::ref(generator) );
-        }
-
-        state_type q( M );
-        state_type p( M );
-
-        for( size_t i=0 ; i<M ; ++i )
-        {
-            q[i] = make_ready_future( std::allocate_shared<dvecvec>( std::allocator<dvecvec>() ) );
-            q[i] = dataflow( hpx::launch::async ,
-                             unwrapped(initialize_zero( G , N2 )) , q[i] );
-            p[i] = make_ready_future( std::allocate_shared<dvecvec>( std::allocator<dvecvec>() ) );
-            p[i] = dataflow( hpx::launch::async ,
-                             unwrapped(initialize_copy( p_init , i*G , G )) , p[i] );
-        }
-
-        wait( q );
-        wait( p );
+    task_priorities::instance().enable( vm.count( "priorities" ) > 0 );
+    const bool split_rhs = vm.count( "split_rhs" ) > 0;
 
-        hpx::util::high_resolution_timer timer;
+    perf_run run( N1 , N2 , G , Gy , fully_random , init_length , steps , dt , tune_steps , split_rhs );
+    dispatch_exponents( kappa , lambda , run );
 
-        integrate_n_steps( stepper_type() , system_2d , 
-                           std::make_pair( boost::ref(q) , boost::ref(p) ) ,
-                           0.0 , dt , steps );
+    std::clog << "blocks allocated: " << block_pool< dvecvec >::instance().allocated() 
+              << ", reused: " << block_pool< dvecvec >::instance().reused() << std::endl;
 
-        //hpx::cout << "dataflow generation ready\n" << hpx::flush;
-
-        wait( q );
-        wait( p );
-
-        double run_time = timer.elapsed();
-
-        if( n > 1 )
-        {
-            avrg_time += run_time;
-            min_time = std::min( run_time , min_time );
-        }
-
-        std::clog << G << ", run: " << n << " run time: " << run_time << std::endl;
-
-    }
-
-    hpx::cout << (boost::format("%d\t%f\t%f\n") % G % min_time % (avrg_time/10)) << hpx::flush;
+    hpx::cout << (boost::format("%d\t%f\t%f\n") % run.G_tuned % run.min_time % (run.avrg_time/10)) << hpx::flush;
 
     return hpx::finalize();
 }
 
-
 int main( int argc , char* argv[] )
 {
     boost::program_options::options_description
@@ -151,6 +221,11 @@ int main( int argc , char* argv[] )
           boost::program_options::value<std::size_t>()->default_value(64),
           "Granularity (64)")
         ;
+    desc_commandline.add_options()
+        ( "Gy",
+          boost::program_options::value<std::size_t>()->default_value(0),
+          "Columns per block, 0 is full rows (0)")
+        ;
     desc_commandline.add_options()
         ( "fully_random",
           boost::program_options::value<bool>()->default_value(true),
@@ -171,6 +246,29 @@ int main( int argc , char* argv[] )
           boost::program_options::value<double>()->default_value(0.1),
           "step size (0.1)")
         ;
+    desc_commandline.add_options()
+        ( "kappa",
+          boost::program_options::value<double>()->default_value(KAPPA),
+          "on-site exponent (3.3)")
+        ;
+    desc_commandline.add_options()
+        ( "lambda",
+          boost::program_options::value<double>()->default_value(LAMBDA),
+          "coupling exponent (4.7)")
+        ;
+    desc_commandline.add_options()
+        ( "tune_steps",
+          boost::program_options::value<std::size_t>()->default_value(0),
+          "auto-tune G starting from --G with this many steps per trial, 0 is off (0)")
+        ;
+    desc_commandline.add_options()
+        ( "split_rhs",
+          "start the rhs of the tile interior before the neighbors are ready, the bonds to them are separate tasks")
+        ;
+    desc_commandline.add_options()
+        ( "priorities",
+          "schedule the coordinate updates and the bonds of --split_rhs before the other work")
+        ;
 
     // Initialize and run HPX
     return hpx::init(desc_commandline, argc, argv);
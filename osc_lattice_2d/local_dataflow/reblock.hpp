@@ -0,0 +1,73 @@
+// Copyright 2013 Mario Mulansky
+// changing the number of rows per block of a futurized 2d state,
+// used for auto-tuning G
+#ifndef REBLOCK_HPP
+#define REBLOCK_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include <hpx/lcos/future.hpp>
+
+#include "../../common/block_pool.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/tile.hpp"
+
+using hpx::lcos::future;
+using hpx::lcos::wait;
+using hpx::make_ready_future;
+
+typedef aligned_dvec dvec;
+typedef tile dvecvec;
+typedef std::shared_ptr< dvecvec > shared_vec;
+typedef std::vector< future< shared_vec > > state_type;
+
+// redistributes x into blocks of G rows, waits for x to be ready.
+// the number of rows has to be a multiple of G.
+inline void reblock( state_type &x , const size_t G )
+{
+    wait( x );
+    size_t rows = 0;
+    for( size_t i=0 ; i<x.size() ; ++i )
+        rows += x[i].get()->size();
+    const size_t cols = x[0].get()->cols();
+    const size_t M = rows/G;
+    state_type y( M );
+    // current source block and row therein
+    size_t src = 0;
+    size_t r = 0;
+    for( size_t i=0 ; i<M ; ++i )
+    {
+        shared_vec b = block_pool< dvecvec >::instance().acquire();
+        b->resize( G , cols );
+        for( size_t g=0 ; g<G ; ++g )
+        {
+            const dvecvec &s = *x[src].get();
+            std::copy( s[r].begin() , s[r].end() , (*b)[g].begin() );
+            if( ++r == s.size() )
+            {
+                ++src;
+                r = 0;
+            }
+        }
+        y[i] = make_ready_future( b );
+    }
+    x.swap( y );
+}
+
+// blocking of futurized states for reblock_trial
+struct reblocking
+{
+    void operator()( state_type &x , const size_t G ) const
+    {
+        reblock( x , G );
+    }
+
+    void wait( state_type &x ) const
+    {
+        hpx::lcos::wait( x );
+    }
+};
+
+#endif
@@ -23,6 +23,10 @@
 #include "initialize.hpp"
 #include "2d_system.hpp"
 
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/tile.hpp"
+#include "../../common/two_pass_symplectic_stepper.hpp"
+
 using hpx::lcos::future;
 using hpx::find_here;
 using hpx::lcos::wait;
@@ -33,8 +37,8 @@ using hpx::util::unwrapped;
 
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 
-typedef std::vector< double > dvec;
-typedef std::vector< dvec > dvecvec;
+typedef aligned_dvec dvec;
+typedef tile dvecvec;
 typedef std::shared_ptr< dvecvec > shared_vec;
 typedef std::vector< future< shared_vec > > state_type;
 
@@ -45,7 +49,10 @@ typedef symplectic_rkn_sb3a_mclachlan< state_type ,
                                        state_type , 
                                        double ,
                                        local_dataflow_algebra ,
-                                       local_dataflow_shared_operations2d > stepper_type;
+                                       local_dataflow_shared_operations2d > odeint_stepper_type;
+
+// the coordinates are updated into new versions of the tiles
+typedef two_pass_symplectic_stepper< odeint_stepper_type > stepper_type;
 
 
 int hpx_main(boost::program_options::variables_map& vm)
@@ -54,18 +61,21 @@ int hpx_main(boost::program_options::variables_map& vm)
     const std::size_t N1 = vm["N1"].as<std::size_t>();
     const std::size_t N2 = vm["N2"].as<std::size_t>();
     const std::size_t G = vm["G"].as<std::size_t>();
+    const std::size_t Gy = ( vm["Gy"].as<std::size_t>() > 0 ) ? vm["Gy"].as<std::size_t>() : N2;
     const bool fully_random = vm["fully_random"].as<bool>();
     const bool do_observation = vm["observe"].as<bool>();
     const std::size_t init_length = vm["init_length"].as<std::size_t>();
     const std::size_t steps = vm["steps"].as<std::size_t>();
     const double dt = vm["dt"].as<double>();
-    const std::size_t M = N1/G;
+    // tiles per row and total number of tiles
+    const std::size_t Mx = N2/Gy;
+    const std::size_t M = (N1/G)*Mx;
 
 
-    std::clog << "Dimension: " << N1 << "x" << N2 << ", number of rows per dataflow: " << G;
+    std::clog << "Dimension: " << N1 << "x" << N2 << ", tile size: " << G << "x" << Gy;
     std::clog << ", number of dataflow: " << M << ", steps: " << steps << ", dt: " << dt << std::endl;
 
-    dvecvec p_init( N1 , dvec( N2 , 0.0 ) );
+    dvecvec p_init( N1 , N2 , 0.0 );
 
     std::uniform_real_distribution<double> distribution( -1.0 , 1.0 );
     std::mt19937 engine( 0 ); // Mersenne twister MT19937
@@ -91,15 +101,15 @@ int hpx_main(boost::program_options::variables_map& vm)
     for( size_t i=0 ; i<M ; ++i )
     {
         q[i] = make_ready_future( std::make_shared<dvecvec>() );
-        q[i] = dataflow( unwrapped(initialize_zero( G , N2 )) , q[i] );
+        q[i] = dataflow( unwrapped(initialize_zero( G , Gy )) , q[i] );
         p[i] = make_ready_future( std::make_shared<dvecvec>() );
-        p[i] = dataflow( unwrapped(initialize_copy( p_init , i*G , G )) , p[i] );
+        p[i] = dataflow( unwrapped(initialize_copy( p_init , (i/Mx)*G , G , (i%Mx)*Gy , Gy )) , p[i] );
     }
 
     wait( q );
     wait( p );
     std::clog.precision(10);
-    std::clog << "Initialization complete, energy: " << energy( q , p ) << std::endl;
+    std::clog << "Initialization complete, energy: " << energy( q , p , Mx ).get() << std::endl;
 
     // std::cout.precision(10);
 
@@ -117,7 +127,7 @@ int hpx_main(boost::program_options::variables_map& vm)
 
     hpx::util::high_resolution_timer timer;
 
-    integrate_n_steps( stepper_type() , system_2d , 
+    integrate_n_steps( stepper_type() , system_2d<>( KAPPA , LAMBDA , Mx ) , 
                        std::make_pair( boost::ref(q) , boost::ref(p) ) ,
                        0.0 , dt , steps );
 
@@ -128,7 +138,7 @@ int hpx_main(boost::program_options::variables_map& vm)
 
     hpx::cout << (boost::format("runtime: %fs\n") %timer.elapsed()) << hpx::flush;
 
-    std::clog << "Integration complete, energy: " << energy( q , p ) << std::endl;
+    std::clog << "Integration complete, energy: " << energy( q , p , Mx ).get() << std::endl;
 
     std::cout.precision(10);
 
@@ -156,6 +166,11 @@ int main( int argc , char* argv[] )
           boost::program_options::value<std::size_t>()->default_value(128),
           "Block size (128)")
         ;
+    desc_commandline.add_options()
+        ( "Gy",
+          boost::program_options::value<std::size_t>()->default_value(0),
+          "Columns per block, 0 is full rows (0)")
+        ;
     desc_commandline.add_options()
         ( "fully_random",
           boost::program_options::value<bool>()->default_value(false),
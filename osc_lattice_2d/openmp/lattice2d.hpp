@@ -6,39 +6,24 @@
 #include <vector>
 #include <cmath>
 #include <iostream>
+#include <algorithm>
 
 #include <omp.h>
 
-#include <boost/math/special_functions/sign.hpp>
+#include "../../common/checked_math.hpp"
+#include "../../common/exponent_policy.hpp"
 
 
-namespace checked_math {
-    inline double pow( double x , double y )
-    {
-        if( x==0.0 )
-            // 0**y = 0, don't care for y = 0 or NaN
-            return 0.0;
-        using std::pow;
-        using std::abs;
-        return pow( abs(x) , y );
-    }
-}
-
-double signed_pow( double x , double k )
-{
-    using boost::math::sign;
-    return checked_math::pow( x , k ) * sign(x);
-}
-
 
+template< class Kappa = real_exponent , class Lambda = real_exponent >
 struct lattice2d {
 
     const double m_beta;
-    const double m_kap;
-    const double m_lam;
+    const Kappa m_kap;
+    const Lambda m_lam;
     int m_threads;
 
-    lattice2d( const double kap , const double lam , 
+    lattice2d( const Kappa kap , const Lambda lam , 
                const double beta )
         : m_kap( kap ) , m_lam( lam ) , m_beta( beta ) , 
           m_threads(0)
@@ -51,6 +36,8 @@ struct lattice2d {
         // q and dpdt are 2d
         const int N = q.size();
         const int M = q[0].size();
+        const typename Kappa::minus_one_type kap1 = m_kap.minus_one();
+        const typename Lambda::minus_one_type lam1 = m_lam.minus_one();
 
         double coupling_lr( 0.0 );
         std::vector<double> coupling_ud( M , 0.0 );
@@ -68,7 +55,7 @@ struct lattice2d {
                 for( size_t j=0 ; j<M ; ++j )
                 {
                     if( i > 0 )
-                        coupling_ud[j] = signed_pow( q[i-1][j]-q[i][j] , m_lam-1 );
+                        coupling_ud[j] = lam1.signed_pow( q[i-1][j]-q[i][j] );
                     else
                         coupling_ud[j] = 0.0;
                     //std::cout << coupling_ud[j] << std::endl;
@@ -79,21 +66,21 @@ struct lattice2d {
             // actual work
             for( size_t j=0 ; j<M-1 ; ++j )
             {
-                dpdt[i][j] = -signed_pow( q[i][j] , m_kap-1 )
+                dpdt[i][j] = -kap1.signed_pow( q[i][j] )
                     + coupling_lr + coupling_ud[j];
-                coupling_lr = signed_pow( q[i][j]-q[i][j+1] , m_lam-1 );
+                coupling_lr = lam1.signed_pow( q[i][j]-q[i][j+1] );
                 if( i<N-1 )
-                    coupling_ud[j] = signed_pow( q[i][j]-q[i+1][j] , m_lam-1 );
+                    coupling_ud[j] = lam1.signed_pow( q[i][j]-q[i+1][j] );
                 else
                     coupling_ud[j] = 0.0;
                 dpdt[i][j] -= coupling_lr + coupling_ud[j];
                 //std::cout << dpdt[i][j] << ": " << q[i][j] << std::endl;
             }
-            dpdt[i][M-1] = -signed_pow( q[i][M-1] , m_kap-1 )
+            dpdt[i][M-1] = -kap1.signed_pow( q[i][M-1] )
                 + coupling_lr + coupling_ud[M-1];
             coupling_lr = 0.0;
             if( i<N-1 )
-                coupling_ud[M-1] = signed_pow( q[i][M-1]-q[i+1][M-1] , m_lam-1 );
+                coupling_ud[M-1] = lam1.signed_pow( q[i][M-1]-q[i+1][M-1] );
             else
                 coupling_ud[M-1] = 0.0;
             dpdt[i][M-1] -= coupling_ud[M-1];
@@ -114,10 +101,11 @@ struct lattice2d {
     template< class StateIn >
     double energy( const StateIn &q , const StateIn &p )
     {
-        using checked_math::pow;
         // q and dpdt are 2d
         const size_t N = q.size();
         const size_t M = q[0].size();
+        const double kap = m_kap.value();
+        const double lam = m_lam.value();
         double energy = 0.0;
 #ifndef NO_OMP
 #pragma omp parallel
@@ -135,13 +123,13 @@ struct lattice2d {
                 for( size_t j=0 ; j<M-1 ; ++j )
                 {
                     energy += p[i][j]*p[i][j] / 2.0
-                        + pow( q[i][j] , m_kap ) / m_kap
-                        + pow( q[i][j]-q[i][j+1] , m_lam ) / m_lam
-                        + pow( q[i][j]-q[i+1][j] , m_lam ) / m_lam;
+                        + m_kap.pow( q[i][j] ) / kap
+                        + m_lam.pow( q[i][j]-q[i][j+1] ) / lam
+                        + m_lam.pow( q[i][j]-q[i+1][j] ) / lam;
                 }
                 energy += p[i][M-1]*p[i][M-1] / 2.0
-                    + pow( q[i][M-1] , m_kap ) / m_kap
-                    + pow( q[i][M-1]-q[i+1][M-1] , m_lam ) / m_lam;
+                    + m_kap.pow( q[i][M-1] ) / kap
+                    + m_lam.pow( q[i][M-1]-q[i+1][M-1] ) / lam;
             }
 #ifndef NO_OMP
         }
@@ -149,11 +137,11 @@ struct lattice2d {
         for( size_t j=0 ; j<M-1 ; ++j )
         {
             energy += p[N-1][j]*p[N-1][j] / 2.0
-                + pow( q[N-1][j] , m_kap ) / m_kap
-                + pow( q[N-1][j]-q[N-1][j+1] , m_lam ) / m_lam;
+                + m_kap.pow( q[N-1][j] ) / kap
+                + m_lam.pow( q[N-1][j]-q[N-1][j+1] ) / lam;
         }
         energy += p[N-1][M-1]*p[N-1][M-1] / 2.0
-            + pow( q[N-1][M-1] , m_kap ) / m_kap;
+            + m_kap.pow( q[N-1][M-1] ) / kap;
         return energy;
     }
 
@@ -199,4 +187,79 @@ struct lattice2d {
 
 };
 
+
+// the rhs as one task per stripe of rows, with the dependencies of the
+// stripes instead of a barrier, see task_range_algebra_omp.hpp. the stripe
+// of dpdt depends on its own stripe of q and on the neighboring ones.
+template< class Kappa = real_exponent , class Lambda = real_exponent >
+struct lattice2d_tasks : lattice2d< Kappa , Lambda >
+{
+    const int m_stripe;
+
+    lattice2d_tasks( const Kappa kap , const Lambda lam ,
+                     const double beta , const int stripe = 8 )
+        : lattice2d< Kappa , Lambda >( kap , lam , beta ) ,
+          m_stripe( std::max( stripe , 1 ) )
+    { }
+
+    template< class StateIn , class StateOut >
+    void operator()( const StateIn &q , StateOut &dpdt ) const
+    {
+        const int N = q.size();
+        const lattice2d_tasks *sys = this;
+        const StateIn *x = &q;
+        StateOut *d = &dpdt;
+        for( int b=0 ; b<N ; b += m_stripe )
+        {
+            const int e = std::min( b+m_stripe , N );
+            // the first and the last stripe stand in for missing neighbors
+            const double *q_l = q[ ( b > 0 ) ? b-m_stripe : b ].data();
+            const double *q_i = q[b].data();
+            const double *q_r = q[ ( e < N ) ? e : b ].data();
+            const double *h = dpdt[b].data();
+#pragma omp task firstprivate( sys , x , d , b , e , q_l , q_i , q_r , h ) depend( in: q_l[0] , q_i[0] , q_r[0] ) depend( out: h[0] )
+            sys->rows( *x , *d , b , e );
+        }
+    }
+
+    // the rows [b,e) of the rhs, like a contiguous chunk of lattice2d
+    template< class StateIn , class StateOut >
+    void rows( const StateIn &q , StateOut &dpdt , const int b , const int e ) const
+    {
+        const int N = q.size();
+        const int M = q[0].size();
+        const typename Kappa::minus_one_type kap1 = this->m_kap.minus_one();
+        const typename Lambda::minus_one_type lam1 = this->m_lam.minus_one();
+
+        double coupling_lr( 0.0 );
+        std::vector<double> coupling_ud( M , 0.0 );
+        if( b > 0 )
+            for( int j=0 ; j<M ; ++j )
+                coupling_ud[j] = lam1.signed_pow( q[b-1][j]-q[b][j] );
+
+        for( int i=b ; i<e ; ++i )
+        {
+            for( int j=0 ; j<M-1 ; ++j )
+            {
+                dpdt[i][j] = -kap1.signed_pow( q[i][j] )
+                    + coupling_lr + coupling_ud[j];
+                coupling_lr = lam1.signed_pow( q[i][j]-q[i][j+1] );
+                if( i<N-1 )
+                    coupling_ud[j] = lam1.signed_pow( q[i][j]-q[i+1][j] );
+                else
+                    coupling_ud[j] = 0.0;
+                dpdt[i][j] -= coupling_lr + coupling_ud[j];
+            }
+            dpdt[i][M-1] = -kap1.signed_pow( q[i][M-1] )
+                + coupling_lr + coupling_ud[M-1];
+            coupling_lr = 0.0;
+            if( i<N-1 )
+                coupling_ud[M-1] = lam1.signed_pow( q[i][M-1]-q[i+1][M-1] );
+            else
+                coupling_ud[M-1] = 0.0;
+            dpdt[i][M-1] -= coupling_ud[M-1];
+        }
+    }
+};
+
 #endif
@@ -15,14 +15,16 @@
 #include "resize.hpp"
 #include "spreading_observer.hpp"
 
+#include "../../common/tile.hpp"
+#include "../../common/granularity_tuner.hpp"
+
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 using boost::numeric::odeint::range_algebra;
 
 using boost::timer::cpu_timer;
 using boost::timer::cpu_times;
 
-typedef std::vector< double > dvec;
-typedef std::vector< dvec > state_type;
+typedef tile state_type;
 
 typedef symplectic_rkn_sb3a_mclachlan< state_type ,
                                        state_type ,
@@ -36,6 +38,104 @@ const double KAPPA = 3.3;
 const double LAMBDA = 4.7;
 const double beta = 1.0;
 
+// the rows are not blocked in memory, the block size is the number of rows
+// per chunk of the static schedule of the loops
+struct reblocking
+{
+    void operator()( state_type & , const size_t G ) const
+    {
+        omp_set_schedule( omp_sched_static , G );
+    }
+
+    void wait( state_type & ) const
+    { }
+};
+
+struct perf_run
+{
+    const int N1;
+    const int N2;
+    const int block_size;
+    const int steps;
+    const double dt;
+    const int tune_steps;
+
+    double avrg_time;
+    double min_time;
+    int G_tuned;
+
+    perf_run( const int N1_ , const int N2_ , const int block_size_ ,
+              const int steps_ , const double dt_ , const int tune_steps_ )
+        : N1( N1_ ) , N2( N2_ ) , block_size( block_size_ ) ,
+          steps( steps_ ) , dt( dt_ ) , tune_steps( tune_steps_ ) ,
+          avrg_time( 0.0 ) , min_time( 1000000.0 ) , G_tuned( block_size_ )
+    { }
+
+    template< class Kappa , class Lambda >
+    void operator()( const Kappa kappa , const Lambda lambda )
+    {
+        for( size_t n=0 ; n<12 ; ++n )
+        {
+
+            lattice2d< Kappa , Lambda > system( kappa , lambda , beta );
+
+            // initialize
+            state_type p_init( N1 , N2 );
+    
+            //fully random
+            for( size_t i=0 ; i<N1 ; ++i )
+            {
+                std::uniform_real_distribution<double> distribution( 0.0 );
+                std::mt19937 engine( i ); // Mersenne twister MT19937
+                auto generator = std::bind( distribution , engine );
+                std::generate( p_init[i].begin() , p_init[i].end() , generator );
+            }
+
+            state_type q( N1 , N2 );
+            state_type p( N1 , N2 );
+
+#pragma omp parallel for schedule( runtime )
+            for( size_t i=0 ; i<N1 ; i++ )
+            {
+                std::copy( p_init[i].begin() , p_init[i].end() , p[i].begin() );
+            }
+
+            //std::cout << "# Initial energy: " << system.energy( q , p ) << std::endl;
+    
+            omp_set_schedule( omp_sched_static , block_size );
+
+            cpu_timer timer;
+
+            // the tuning trials are the first steps of the run
+            int steps_left = steps;
+            if( tune_steps > 0 )
+            {
+                reblock_trial< stepper_type , lattice2d< Kappa , Lambda > , state_type , reblocking >
+                    trial( q , p , system , dt , tune_steps , steps );
+                G_tuned = tune_granularity( trial , N1 , block_size , 1 , N1/omp_get_max_threads() );
+                omp_set_schedule( omp_sched_static , G_tuned );
+                steps_left = std::max( 0 , steps - static_cast<int>( trial.m_steps_done ) );
+            }
+
+            integrate_n_steps( stepper_type() , 
+                               system , 
+                               std::make_pair( std::ref(q) , std::ref(p) ) , 
+                               0.0 , dt , steps_left );
+
+            double run_time = static_cast<double>(timer.elapsed().wall)/(1000*1000*1000);
+
+            if( n > 1 )
+            {
+                min_time = std::min( min_time , run_time );
+                avrg_time += run_time;
+            }
+
+            std::clog << "G: " << G_tuned << ", run " << n << ": " << run_time << std::endl;
+
+        }
+    }
+};
+
 int main( int argc , char* argv[] )
 {
     int N1 = 1024;
@@ -44,6 +144,8 @@ int main( int argc , char* argv[] )
     int init_length = 128;
     int steps = 10;
     double dt = 0.1;
+    double kappa = KAPPA;
+    double lambda = LAMBDA;
     if( argc > 1 )
         N1 = atoi( argv[1] );
     if( argc > 2 )
@@ -52,64 +154,25 @@ int main( int argc , char* argv[] )
         block_size = atoi( argv[3] );
     if( argc > 4 )
         steps = atoi( argv[4] );
+    if( argc > 5 )
+        kappa = atof( argv[5] );
+    if( argc > 6 )
+        lambda = atof( argv[6] );
+    // auto-tune the chunk size starting from block_size with this many steps
+    // per trial
+    int tune_steps = 0;
+    if( argc > 7 )
+        tune_steps = atoi( argv[7] );
 
     //std::clog << "Size: " << N1 << "x" << N2 << " with " << steps << " steps" << std::endl;
 
     //omp_set_schedule( omp_sched_dynamic , block_size );
     omp_set_schedule( omp_sched_static , block_size );
 
-    double avrg_time = 0.0;
-    double min_time = 1000000.0;
-        
-    for( size_t n=0 ; n<12 ; ++n )
-    {
-
-        lattice2d system( KAPPA , LAMBDA , beta );
-
-        // initialize
-        state_type p_init( N1 , dvec( N2 ) );
-    
-        //fully random
-        for( size_t i=0 ; i<N1 ; ++i )
-        {
-            std::uniform_real_distribution<double> distribution( 0.0 );
-            std::mt19937 engine( i ); // Mersenne twister MT19937
-            auto generator = std::bind( distribution , engine );
-            std::generate( p_init[i].begin() , p_init[i].end() , generator );
-        }
-
-        state_type q( N1 );
-        state_type p( N1 );
-
-#pragma omp parallel for schedule( runtime )
-        for( size_t i=0 ; i<N1 ; i++ )
-        {
-            q[i] = dvec( N2 , 0.0 );
-            p[i] = p_init[i];
-        }
-
-        //std::cout << "# Initial energy: " << system.energy( q , p ) << std::endl;
-    
-        cpu_timer timer;
-
-        integrate_n_steps( stepper_type() , 
-                           system , 
-                           std::make_pair( std::ref(q) , std::ref(p) ) , 
-                           0.0 , dt , steps );
-
-        double run_time = static_cast<double>(timer.elapsed().wall)/(1000*1000*1000);
-
-        if( n > 1 )
-        {
-            min_time = std::min( min_time , run_time );
-            avrg_time += run_time;
-        }
-
-        std::clog << "G: " << block_size << ", run " << n << ": " << run_time << std::endl;
-
-    }
+    perf_run run( N1 , N2 , block_size , steps , dt , tune_steps );
+    dispatch_exponents( kappa , lambda , run );
 
-    std::cout << block_size << '\t' << min_time << '\t' << avrg_time/(10) << std::endl;
+    std::cout << run.G_tuned << '\t' << run.min_time << '\t' << run.avrg_time/(10) << std::endl;
 
     return 0;
 }
@@ -0,0 +1,160 @@
+// Copyright 2013 Mario Mulansky
+//
+// the lattice with openmp tasks per stripe of block_size rows, ordered by
+// their dependencies instead of barriers, see task_range_algebra_omp.hpp.
+// the producer runs at most lookahead steps ahead of the tasks.
+
+#include <iostream>
+#include <vector>
+#include <random>
+
+#include <omp.h>
+
+#include <boost/numeric/odeint.hpp>
+#include <boost/timer/timer.hpp>
+#include <boost/foreach.hpp>
+
+#include "lattice2d.hpp"
+#include "task_range_algebra_omp.hpp"
+#include "resize.hpp"
+#include "spreading_observer.hpp"
+
+#include "../../common/tile.hpp"
+
+using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
+using boost::numeric::odeint::range_algebra;
+
+using boost::timer::cpu_timer;
+using boost::timer::cpu_times;
+
+typedef tile state_type;
+
+typedef symplectic_rkn_sb3a_mclachlan< state_type ,
+                                       state_type ,
+                                       double ,
+                                       state_type ,
+                                       state_type , 
+                                       double ,
+                                       task_range_algebra_omp<range_algebra> > stepper_type;
+
+const double KAPPA = 3.3;
+const double LAMBDA = 4.7;
+const double beta = 1.0;
+
+struct perf_run
+{
+    const int N1;
+    const int N2;
+    const int block_size;
+    const int steps;
+    const double dt;
+    const int lookahead;
+
+    double avrg_time;
+    double min_time;
+
+    perf_run( const int N1_ , const int N2_ , const int block_size_ ,
+              const int steps_ , const double dt_ , const int lookahead_ )
+        : N1( N1_ ) , N2( N2_ ) , block_size( block_size_ ) ,
+          steps( steps_ ) , dt( dt_ ) , lookahead( lookahead_ ) ,
+          avrg_time( 0.0 ) , min_time( 1000000.0 )
+    { }
+
+    template< class Kappa , class Lambda >
+    void operator()( const Kappa kappa , const Lambda lambda )
+    {
+        for( size_t n=0 ; n<12 ; ++n )
+        {
+
+            lattice2d_tasks< Kappa , Lambda > system( kappa , lambda , beta , block_size );
+
+            // initialize
+            state_type p_init( N1 , N2 );
+    
+            //fully random
+            for( int i=0 ; i<N1 ; ++i )
+            {
+                std::uniform_real_distribution<double> distribution( 0.0 );
+                std::mt19937 engine( i ); // Mersenne twister MT19937
+                auto generator = std::bind( distribution , engine );
+                std::generate( p_init[i].begin() , p_init[i].end() , generator );
+            }
+
+            state_type q( N1 , N2 );
+            state_type p( N1 , N2 );
+
+#pragma omp parallel for schedule( runtime )
+            for( int i=0 ; i<N1 ; i++ )
+            {
+                std::copy( p_init[i].begin() , p_init[i].end() , p[i].begin() );
+            }
+
+            //std::cout << "# Initial energy: " << system.energy( q , p ) << std::endl;
+    
+            cpu_timer timer;
+
+            // the stepper owns the temporaries the tasks write, it lives
+            // until the tasks are done at the end of the parallel region
+            stepper_type stepper = stepper_type( task_range_algebra_omp< range_algebra >( block_size ) );
+#pragma omp parallel
+#pragma omp single
+            for( int s=0 ; s<steps ; s += lookahead )
+            {
+                integrate_n_steps( boost::ref( stepper ) ,
+                                   boost::ref( system ) ,
+                                   std::make_pair( std::ref(q) , std::ref(p) ) ,
+                                   s*dt , dt , std::min( lookahead , steps-s ) );
+#pragma omp taskwait
+            }
+
+            double run_time = static_cast<double>(timer.elapsed().wall)/(1000*1000*1000);
+
+            if( n > 1 )
+            {
+                min_time = std::min( min_time , run_time );
+                avrg_time += run_time;
+            }
+
+            std::clog << "G: " << block_size << ", run " << n << ": " << run_time << std::endl;
+
+        }
+    }
+};
+
+int main( int argc , char* argv[] )
+{
+    int N1 = 1024;
+    int N2 = 1024;
+    int block_size = 8;
+    int steps = 10;
+    double dt = 0.1;
+    double kappa = KAPPA;
+    double lambda = LAMBDA;
+    int lookahead = 4;
+    if( argc > 1 )
+        N1 = atoi( argv[1] );
+    if( argc > 2 )
+        N2 = atoi( argv[2] );
+    if( argc > 3 )
+        block_size = atoi( argv[3] );
+    if( argc > 4 )
+        steps = atoi( argv[4] );
+    if( argc > 5 )
+        kappa = atof( argv[5] );
+    if( argc > 6 )
+        lambda = atof( argv[6] );
+    // number of steps whose tasks are created before waiting for them
+    if( argc > 7 )
+        lookahead = std::max( 1 , atoi( argv[7] ) );
+
+    //std::clog << "Size: " << N1 << "x" << N2 << " with " << steps << " steps" << std::endl;
+
+    omp_set_schedule( omp_sched_static , block_size );
+
+    perf_run run( N1 , N2 , block_size , steps , dt , lookahead );
+    dispatch_exponents( kappa , lambda , run );
+
+    std::cout << block_size << '\t' << run.min_time << '\t' << run.avrg_time/(10) << std::endl;
+
+    return 0;
+}
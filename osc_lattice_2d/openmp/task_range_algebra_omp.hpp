@@ -0,0 +1,52 @@
+/* nested range algebra with one task per stripe of rows */
+
+#ifndef TASK_RANGE_ALGEBRA_OMP_HPP
+#define TASK_RANGE_ALGEBRA_OMP_HPP
+
+#include <algorithm>
+
+// the update of the rows [b,b+stripe) is a task that writes this stripe of
+// s1 and reads the stripes of s2 and s3. the first value of a stripe is its
+// dependency handle, the rows of a tile do not move within a step. like the
+// task algebra of the chain it only creates the tasks and has to be called
+// from a single region, the stripes have to match those of lattice2d_tasks.
+template< class InnerAlgebra >
+struct task_range_algebra_omp
+{
+    size_t m_stripe;
+
+    task_range_algebra_omp( const size_t stripe = 8 )
+        : m_stripe( std::max< size_t >( stripe , 1 ) )
+    { }
+
+    template< class S1 , class S2 , class S3 , class Op >
+    void for_each3( S1 &s1 , S2 &s2 , S3 &s3 , Op op )
+    {
+        InnerAlgebra inner = m_inner_algebra;
+        for( size_t b=0 ; b<s1.size() ; b += m_stripe )
+        {
+            const size_t e = std::min( b+m_stripe , s1.size() );
+            auto *x1 = &s1;
+            auto *x2 = &s2;
+            auto *x3 = &s3;
+            const double *h1 = s1[b].data();
+            const double *h2 = s2[b].data();
+            const double *h3 = s3[b].data();
+#pragma omp task firstprivate( x1 , x2 , x3 , b , e , op , inner ) depend( inout: h1[0] ) depend( in: h2[0] , h3[0] )
+            for( size_t i=b ; i<e ; ++i )
+            {
+                // the rows are views into the tiles, the inner algebra takes references
+                auto r1 = (*x1)[i];
+                auto r2 = (*x2)[i];
+                auto r3 = (*x3)[i];
+                inner.for_each3( r1 , r2 , r3 , op );
+            }
+        }
+    }
+
+
+private:
+    InnerAlgebra m_inner_algebra;
+};
+
+#endif
@@ -2,10 +2,17 @@
 #define INITIALIZE_HPP
 
 #include <memory>
+#include <vector>
+#include <algorithm>
+
+#include "../../common/block_pool.hpp"
 
 typedef std::vector< double > dvec;
 typedef std::shared_ptr< dvec > shared_vec;
 
+// the initializers return a block from the pool, v is only a placeholder
+// that orders the initialization
+
 struct initialize_zero
 {
     const size_t m_N;
@@ -14,8 +21,9 @@ struct initialize_zero
         : m_N( N )
     { }
 
-    shared_vec operator()( shared_vec v ) const
+    shared_vec operator()( shared_vec ) const
     {
+        shared_vec v = block_pool< dvec >::instance().acquire();
         //hpx::cout << "initializing vector with zero ...\n" << hpx::flush;
         v->resize( m_N );
         std::fill( v->begin() , v->end() , 0.0 );
@@ -34,8 +42,9 @@ struct initialize_copy
         : m_data( data ) , m_index( index ) , m_len( len )
     { }
 
-    shared_vec operator()( shared_vec v ) const
+    shared_vec operator()( shared_vec ) const
     {
+        shared_vec v = block_pool< dvec >::instance().acquire();
         //hpx::cout << boost::format("initializing vector from data at index %d ...\n") % m_index << hpx::flush;
         v->resize( m_len );
         std::copy( &(m_data[m_index]) , &(m_data[m_index+m_len]) , v->begin() );
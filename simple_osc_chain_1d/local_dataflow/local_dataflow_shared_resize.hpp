@@ -14,6 +14,8 @@
 #include <hpx/lcos/local/dataflow.hpp>
 #include <hpx/util/unwrapped.hpp>
 
+#include "../../common/block_pool.hpp"
+
 using hpx::lcos::shared_future;
 using hpx::make_ready_future;
 using hpx::lcos::local::dataflow;
@@ -71,7 +73,8 @@ struct resize_impl< state_type , state_type >
         {
             x1[i] = dataflow( unwrapped([]( shared_vec v2 )
                 {
-                    shared_vec tmp = std::make_shared<dvec>( v2->size() );
+                    shared_vec tmp = block_pool< dvec >::instance().acquire();
+                    tmp->resize( v2->size() );
                     return tmp;
                 }) ,
                               x2[i] );
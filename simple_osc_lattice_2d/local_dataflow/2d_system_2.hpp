@@ -6,6 +6,7 @@
 #include <vector>
 #include <memory>
 #include <cmath>
+#include <algorithm>
 
 #include <boost/math/special_functions/pow.hpp>
 #include <boost/thread/thread.hpp>
@@ -15,6 +16,9 @@
 #include <hpx/include/iostreams.hpp>
 #include <hpx/util/unwrap.hpp>
 
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/tile.hpp"
+
 using hpx::lcos::local::dataflow;
 using hpx::lcos::future;
 using hpx::lcos::wait;
@@ -22,17 +26,16 @@ using hpx::util::unwrap;
 
 using boost::math::pow;
 
-typedef std::vector< double > dvec;
-typedef std::vector< dvec > dvecvec;
+typedef aligned_dvec dvec;
+typedef tile dvecvec;
 typedef std::shared_ptr< dvecvec > shared_vecvec;
 typedef std::vector< future< shared_vec > > state_type;
 
 template< int Kappa , int Lambda >
 struct system_first_block
 {
-    shared_vecvec operator()( shared_vecvec q , const dvec *q_d_ , shared_vecvec dpdt ) const
+    shared_vecvec operator()( shared_vecvec q , const double *q_d , shared_vecvec dpdt ) const
     {
-        const dvec &q_d = *q_d_;
         //hpx::cout << (boost::format("first block\n") ) << hpx::flush;
 
         const size_t N = q->size();
@@ -76,11 +79,9 @@ template< int Kappa , int Lambda >
 struct system_center_block
 {
 
-    shared_vecvec operator() ( shared_vecvec q , const dvec *q_u_ , 
-                               const dvec *q_d_ , shared_vecvec dpdt ) const
+    shared_vecvec operator() ( shared_vecvec q , const double *q_u , 
+                               const double *q_d , shared_vecvec dpdt ) const
     {
-        const dvec &q_u = *q_u_;
-        const dvec &q_d = *q_d_;
         //hpx::cout << (boost::format("center block\n") ) << hpx::flush;
  
         const size_t N = q->size();
@@ -144,9 +145,8 @@ struct system_last_block
 
     typedef shared_vec result_type;
 
-    shared_vecvec operator()( shared_vecvec q , const dvec *q_u_ , shared_vecvec dpdt ) const
+    shared_vecvec operator()( shared_vecvec q , const double *q_u , shared_vecvec dpdt ) const
     {
-        const dvec &q_u = *q_u_;
         //hpx::cout << (boost::format("last block\n") ) << hpx::flush;
 
         const size_t N = q->size();
@@ -224,7 +224,7 @@ struct system_2d
                             unwrap(system_first_block<Kappa,Lambda>()) , 
                             q[0] , 
                             dataflow( hpx::launch::sync , unwrap([](shared_vecvec v) 
-            { return &((*v)[0]); }) , q[1] ) , 
+            { return (*v)[0].data(); }) , q[1] ) , 
                             dpdt[0] );
         // middle rows
         for( size_t i=1 ; i<N-1 ; i++ )
@@ -233,17 +233,17 @@ struct system_2d
                                  unwrap(system_center_block<Kappa,Lambda>()) , 
                                  q[i] , 
                                  dataflow( hpx::launch::sync , unwrap([](shared_vecvec v) 
-                { return &((*v)[v->size()-1]); }) ,
+                { return (*v)[v->size()-1].data(); }) ,
                                            q[i-1] ) , 
                                  dataflow( hpx::launch::sync , unwrap([](shared_vecvec v) 
-                { return &((*v)[0]); }) , q[i+1] ) ,
+                { return (*v)[0].data(); }) , q[i+1] ) ,
                                  dpdt[i] );
         }
         dpdt[N-1] = dataflow( hpx::launch::async , 
                                unwrap(system_last_block<Kappa,Lambda>()) , 
                                q[N-1] , 
                                dataflow( hpx::launch::sync , unwrap([](shared_vecvec v) 
-            { return &((*v)[v->size()-1]); }), 
+            { return (*v)[v->size()-1].data(); }), 
                                          q[N-2] ) , 
                                dpdt[N-1] );
         /*
@@ -295,13 +295,20 @@ struct system_2d
     template< typename S >
     double energy( const S &q_fut , const S &p_fut )
     {
-        dvecvec q,p;
+        size_t N = 0;
+        for( size_t i=0 ; i<q_fut.size() ; ++i )
+            N += q_fut[i].get()->size();
+        dvecvec q( N , q_fut[0].get()->cols() );
+        dvecvec p( N , q_fut[0].get()->cols() );
+        size_t n = 0;
         for( size_t i=0 ; i<q_fut.size() ; ++i )
         {
-            for( size_t j=0 ; j<(*(q_fut[i].get())).size() ; ++j )
+            const dvecvec &q_i = *(q_fut[i].get());
+            const dvecvec &p_i = *(p_fut[i].get());
+            for( size_t j=0 ; j<q_i.size() ; ++j , ++n )
             {
-                q.push_back( (*(q_fut[i].get()))[j] );
-                p.push_back( (*(p_fut[i].get()))[j] );
+                std::copy( q_i[j].begin() , q_i[j].end() , q[n].begin() );
+                std::copy( p_i[j].begin() , p_i[j].end() , p[n].begin() );
             }
         }
         return energy( q , p );
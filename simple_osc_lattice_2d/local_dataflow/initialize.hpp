@@ -2,9 +2,15 @@
 #define INITIALIZE_HPP
 
 #include <memory>
+#include <vector>
+#include <algorithm>
 
-typedef std::vector< double > dvec;
-typedef std::vector< dvec > dvecvec;
+#include "../../common/block_pool.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/tile.hpp"
+
+typedef aligned_dvec dvec;
+typedef tile dvecvec;
 typedef std::shared_ptr< dvecvec > shared_vec;
 
 struct initialize_zero
@@ -18,14 +24,10 @@ struct initialize_zero
 
     shared_vec operator()( int ) const
     {
-        shared_vec v = std::allocate_shared<dvecvec>( std::allocator<dvecvec>() );
+        shared_vec v = block_pool< dvecvec >::instance().acquire();
         //hpx::cout << "initializing vector with zero ...\n" << hpx::flush;
-        v->resize( m_N1 );
-        for( size_t n=0 ; n<m_N1 ; ++n )
-        {
-            (*v)[n].resize( m_N2 );
-            std::fill( (*v)[n].begin() , (*v)[n].end() , 0.0 );
-        }
+        v->resize( m_N1 , m_N2 );
+        v->fill( 0.0 );
         //hpx::cout << "initializing vector with zero finished\n" << hpx::flush;
         return v;
     }
@@ -45,13 +47,11 @@ struct initialize_copy
 
     shared_vec operator()( int ) const
     {
-        shared_vec v = std::allocate_shared<dvecvec>( std::allocator<dvecvec>() );
+        shared_vec v = block_pool< dvecvec >::instance().acquire();
         //hpx::cout << boost::format("initializing vector from data at index %d ...\n") % m_index << hpx::flush;
-        v->resize( m_len );
+        v->resize( m_len , m_data.cols() );
         for( size_t n=0 ; n<m_len ; ++n )
         {
-            //hpx::cout << boost::format("resizing sub vector %d of %d to size %d ...\n") % n % m_len % (m_data[m_index+n].size()) << hpx::flush;
-            (*v)[n].resize( m_data[m_index+n].size() );
             //hpx::cout << boost::format("copying data %d of %d ...\n") % n % m_len << hpx::flush;
             std::copy( m_data[m_index+n].begin() , m_data[m_index+n].end() , (*v)[n].begin() );
         }
@@ -14,13 +14,17 @@
 #include <hpx/lcos/local/dataflow.hpp>
 #include <hpx/util/unwrap.hpp>
 
+#include "../../common/block_pool.hpp"
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/tile.hpp"
+
 using hpx::lcos::future;
 using hpx::make_ready_future;
 using hpx::lcos::local::dataflow;
 using hpx::util::unwrap;
 
-typedef std::vector< double > dvec;
-typedef std::vector< dvec > dvecvec;
+typedef aligned_dvec dvec;
+typedef tile dvecvec;
 typedef std::shared_ptr< dvecvec > shared_vec;
 typedef std::vector< future< shared_vec > > state_type;
 
@@ -73,10 +77,8 @@ struct resize_impl< state_type , state_type >
             x1[i] = dataflow( hpx::launch::async,
                               unwrap([]( shared_vec v2 )
                               {
-                                  shared_vec tmp = std::allocate_shared<dvecvec>( std::allocator<dvecvec>() );
-                                  tmp->resize( v2->size() );
-                                  for( size_t n=0 ; n<v2->size() ; ++n )
-                                      (*tmp)[n].resize( (*v2)[n].size() );
+                                  shared_vec tmp = block_pool< dvecvec >::instance().acquire();
+                                  tmp->resize( v2->size() , v2->cols() );
                                   return tmp;
                               }) ,
                               x2[i] );
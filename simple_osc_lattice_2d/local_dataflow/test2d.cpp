@@ -23,6 +23,9 @@
 #include "initialize.hpp"
 #include "2d_system.hpp"
 
+#include "../../common/aligned_allocator.hpp"
+#include "../../common/tile.hpp"
+
 using hpx::lcos::future;
 using hpx::find_here;
 using hpx::lcos::wait;
@@ -33,8 +36,8 @@ using hpx::util::unwrap;
 
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 
-typedef std::vector< double > dvec;
-typedef std::vector< dvec > dvecvec;
+typedef aligned_dvec dvec;
+typedef tile dvecvec;
 typedef std::shared_ptr< dvecvec > shared_vec;
 typedef std::vector< future< shared_vec > > state_type;
 
@@ -67,7 +70,7 @@ int hpx_main(boost::program_options::variables_map& vm)
     std::clog << "Dimension: " << N1 << "x" << N2 << ", number of rows per dataflow: " << G;
     std::clog << ", number of dataflow: " << M << ", steps: " << steps << ", dt: " << dt << std::endl;
 
-    dvecvec p_init( N1 , dvec( N2 , 0.0 ) );
+    dvecvec p_init( N1 , N2 , 0.0 );
 
     std::uniform_real_distribution<double> distribution( -1.0 , 1.0 );
     std::mt19937 engine( 0 ); // Mersenne twister MT19937
@@ -11,8 +11,14 @@ struct nested_omp_algebra
     void for_each3( S1 &s1 , S2 &s2 , S3 &s3 , Op op )
     {
 #pragma omp parallel for schedule(runtime)
-        for( size_t i=0 ; i<boost::size(s1) ; ++i )
-            m_inner_algebra.for_each3( s1[i] , s2[i] , s3[i] , op );
+        for( size_t i=0 ; i<s1.size() ; ++i )
+        {
+            // the rows are views into the tiles, the inner algebra takes references
+            auto r1 = s1[i];
+            auto r2 = s2[i];
+            auto r3 = s3[i];
+            m_inner_algebra.for_each3( r1 , r2 , r3 , op );
+        }
     }
 
 
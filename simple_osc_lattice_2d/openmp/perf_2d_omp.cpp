@@ -15,14 +15,15 @@
 #include "resize.hpp"
 #include "spreading_observer.hpp"
 
+#include "../../common/tile.hpp"
+
 using boost::numeric::odeint::symplectic_rkn_sb3a_mclachlan;
 using boost::numeric::odeint::range_algebra;
 
 using boost::timer::cpu_timer;
 using boost::timer::cpu_times;
 
-typedef std::vector< double > dvec;
-typedef std::vector< dvec > state_type;
+typedef tile state_type;
 
 typedef symplectic_rkn_sb3a_mclachlan< state_type ,
                                        state_type ,
@@ -67,7 +68,7 @@ int main( int argc , char* argv[] )
         lattice2d<KAPPA,LAMBDA> system( beta );
 
         // initialize
-        state_type p_init( N1 , dvec( N2 ) );
+        state_type p_init( N1 , N2 );
     
         //fully random
         for( size_t i=0 ; i<N1 ; ++i )
@@ -78,14 +79,13 @@ int main( int argc , char* argv[] )
             std::generate( p_init[i].begin() , p_init[i].end() , generator );
         }
 
-        state_type q( N1 );
-        state_type p( N1 );
+        state_type q( N1 , N2 );
+        state_type p( N1 , N2 );
 
 #pragma omp parallel for schedule( runtime )
         for( size_t i=0 ; i<N1 ; i++ )
         {
-            q[i] = dvec( N2 , 0.0 );
-            p[i] = p_init[i];
+            std::copy( p_init[i].begin() , p_init[i].end() , p[i].begin() );
         }
 
         //std::cout << "# Initial energy: " << system.energy( q , p ) << std::endl;
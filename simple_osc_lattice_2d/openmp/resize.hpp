@@ -4,23 +4,37 @@
 #include <iostream>
 
 #include <boost/numeric/odeint/util/resize.hpp>
+#include <boost/numeric/odeint/util/is_resizeable.hpp>
+#include <boost/numeric/odeint/util/same_size.hpp>
+
+#include "../../common/tile.hpp"
 
 namespace boost { namespace numeric { namespace odeint {
 
-typedef std::vector< std::vector< double > > state_type;
+typedef tile state_type;
+
+template<>
+struct is_resizeable< state_type >
+{
+    typedef boost::true_type type;
+    const static bool value = type::value;
+};
+
+template<>
+struct same_size_impl< state_type , state_type >
+{
+    static bool same_size( const state_type &x1 , const state_type &x2 )
+    {
+        return ( x1.size() == x2.size() ) && ( x1.cols() == x2.cols() );
+    }
+};
 
 template<>
 struct resize_impl< state_type , state_type >
 {
     static void resize( state_type &out , const state_type &in )
     {
-        size_t N = boost::size( in );
-        out.resize( N );
-#pragma omp parallel for schedule( runtime )
-        for( size_t n=0 ; n<N ; ++n )
-        {
-            out[n].resize( boost::size( in[n] ) );
-        }
+        out.resize( in.size() , in.cols() );
     }
 };
 